@@ -0,0 +1,230 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "DifficultyCalculator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace
+{
+
+// Osu! pixels per play field unit, the loader maps the 384 pixel tall play field onto [-1, 1].
+constexpr double PLAY_FIELD_UNIT = 192.0;
+// Distances are scaled as if every circle had this radius (in osu! pixels).
+constexpr double NORMALIZED_RADIUS = 52.0;
+// Objects closer together in time are rated as if they were this far apart (in milliseconds).
+constexpr double MIN_STRAIN_TIME = 50.0;
+constexpr double SECTION_LENGTH = 400.0;
+constexpr double DECAY_WEIGHT = 0.9;
+constexpr double DIFFICULTY_MULTIPLIER = 0.0675;
+
+constexpr double SINGLE_SPACING_THRESHOLD = 125.0;
+constexpr double STREAM_SPACING_THRESHOLD = 110.0;
+constexpr double ALMOST_DIAMETER = 90.0;
+
+struct DifficultyObject
+{
+    double startTime;
+    // Time since the previous object, in milliseconds.
+    double strainTime;
+    // Normalized distance from where the cursor left the previous object, plus the distance travelled along it.
+    double distance;
+};
+
+struct Skill
+{
+    double multiplier{};
+    double decayBase{};
+
+    double strain = 0.0;
+    double sectionPeak = 0.0;
+    std::vector<double> peaks{};
+
+    [[nodiscard]] double decay(double milliseconds) const
+    {
+        return std::pow(decayBase, milliseconds / 1000.0);
+    }
+
+    void process(double value, double deltaTime)
+    {
+        strain = strain * decay(deltaTime) + value * multiplier;
+        sectionPeak = std::max(sectionPeak, strain);
+    }
+
+    void startSection(double sinceLastObject)
+    {
+        peaks.push_back(sectionPeak);
+        sectionPeak = strain * decay(sinceLastObject);
+    }
+
+    double difficulty()
+    {
+        peaks.push_back(sectionPeak);
+        std::sort(peaks.begin(), peaks.end(), std::greater<>());
+
+        double total = 0.0;
+        double weight = 1.0;
+        for (auto peak : peaks) {
+            total += peak * weight;
+            weight *= DECAY_WEIGHT;
+        }
+        return total;
+    }
+};
+
+double AimValue(const DifficultyObject &object)
+{
+    return std::pow(object.distance, 0.99) / object.strainTime;
+}
+
+double SpeedValue(const DifficultyObject &object)
+{
+    double distance = std::min(object.distance, SINGLE_SPACING_THRESHOLD);
+
+    double speedValue;
+    if (distance > STREAM_SPACING_THRESHOLD) {
+        speedValue = 1.6 + 0.9 * (distance - STREAM_SPACING_THRESHOLD) / (SINGLE_SPACING_THRESHOLD - STREAM_SPACING_THRESHOLD);
+    } else if (distance > ALMOST_DIAMETER) {
+        speedValue = 1.2 + 0.4 * (distance - ALMOST_DIAMETER) / (STREAM_SPACING_THRESHOLD - ALMOST_DIAMETER);
+    } else if (distance > ALMOST_DIAMETER / 2.0) {
+        speedValue = 0.95 + 0.25 * (distance - ALMOST_DIAMETER / 2.0) / (ALMOST_DIAMETER / 2.0);
+    } else {
+        speedValue = 0.95;
+    }
+    return speedValue / object.strainTime;
+}
+
+/**
+ * Where the cursor enters and leaves an object and how far it travels on it, in play field units.
+ */
+struct ObjectPath
+{
+    fvec2d start;
+    fvec2d end;
+    double travelled = 0.0;
+    bool spinner = false;
+};
+
+ObjectPath GetPath(const ObjectTemplateStore &objects, size_t i, double followRadius)
+{
+    ObjectPath path;
+    path.start = path.end = objects.getPositions()[i];
+
+    switch (objects.getTypes()[i]) {
+        case HitObjectType::Note:
+            break;
+        case HitObjectType::Slider: {
+            auto points = objects.getPath(i);
+            if (points.size() < 2) {
+                break;
+            }
+
+            // every curve type ends on its last node and is measured along its control points, a lazy cursor only
+            // follows the ball once it leaves the follow circle
+            double length = 0.0;
+            for (size_t point = 1; point < points.size(); point++) {
+                length += math::Distance(points[point - 1], points[point]);
+            }
+
+            auto repeats = objects.getSlider(i).repeats;
+            if (repeats % 2 == 1) {
+                path.end = points.back();
+            }
+            path.travelled = std::max(length - followRadius, 0.0) * repeats;
+            break;
+        }
+        case HitObjectType::Spinner:
+        default:
+            path.spinner = true;
+            break;
+    }
+
+    return path;
+}
+
+}
+
+DifficultyAttributes CalculateDifficulty(const MapInfo &map)
+{
+    DifficultyAttributes attributes;
+
+    const auto &objects = map.getObjectTemplates();
+    auto startTimes = objects.getStartTimes();
+
+    if (objects.size() < 2 || map.circleSize <= 0.0f) {
+        return attributes;
+    }
+
+    // the circle size is kept in the game's own scale, the ratings have to use the radius osu! gives the same level
+    double circleSizeLevel = (0.220392156862745 - map.circleSize * 0.5) / 0.0179411764705882;
+    double radius = std::max(54.4 - 4.48 * circleSizeLevel, 1.0);
+    // from play field units to osu! pixels of a circle with the normalized radius
+    double scale = PLAY_FIELD_UNIT * NORMALIZED_RADIUS / radius;
+    double followRadius = radius * 3.0 / PLAY_FIELD_UNIT;
+
+    Skill aim{26.25, 0.15};
+    Skill speed{1400.0, 0.3};
+
+    auto previous = GetPath(objects, 0, followRadius);
+    double previousTime = startTimes.front() * 1000.0;
+    double sectionEnd = std::ceil(previousTime / SECTION_LENGTH) * SECTION_LENGTH;
+
+    for (size_t i = 1; i < objects.size(); i++) {
+        auto current = GetPath(objects, i, followRadius);
+
+        DifficultyObject object{};
+        object.startTime = startTimes[i] * 1000.0;
+        object.strainTime = std::max(object.startTime - previousTime, MIN_STRAIN_TIME);
+        if (!current.spinner && !previous.spinner) {
+            double jump = math::Distance(previous.end, current.start) * scale;
+            object.distance = jump + previous.travelled * scale;
+        }
+
+        while (object.startTime > sectionEnd) {
+            aim.startSection(sectionEnd - previousTime);
+            speed.startSection(sectionEnd - previousTime);
+            sectionEnd += SECTION_LENGTH;
+        }
+
+        double deltaTime = object.startTime - previousTime;
+        aim.process(AimValue(object), deltaTime);
+        speed.process(SpeedValue(object), deltaTime);
+
+        previous = current;
+        previousTime = object.startTime;
+    }
+
+    double aimRating = std::sqrt(aim.difficulty()) * DIFFICULTY_MULTIPLIER;
+    double speedRating = std::sqrt(speed.difficulty()) * DIFFICULTY_MULTIPLIER;
+
+    attributes.aim = float(aimRating);
+    attributes.speed = float(speedRating);
+    attributes.stars = float(aimRating + speedRating + std::abs(speedRating - aimRating) / 2.0);
+    return attributes;
+}
+
+}
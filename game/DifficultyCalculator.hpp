@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "define.hpp"
+
+#include "MapInfo.hpp"
+
+namespace PROJECT_NAMESPACE {
+
+struct DifficultyAttributes
+{
+    // How hard the map is to aim, from the distances between objects and how quickly they have to be covered.
+    float aim = 0.0f;
+    // How hard the map is to tap, from how closely objects follow each other.
+    float speed = 0.0f;
+    // The overall star rating, combining aim and speed.
+    float stars = 0.0f;
+};
+
+/**
+ * Rates how hard a map is to play.
+ *
+ * Every hit object adds to an aim and a speed strain which decay over time, the strain peaks of consecutive 400ms
+ * sections are then summed with decreasing weights, so a map's hardest parts count the most. The constants follow
+ * the osu! difficulty calculator the star ratings of imported maps are known from.
+ *
+ * Only reads the map, so any number of maps can be rated at once on the task pool.
+ */
+DifficultyAttributes CalculateDifficulty(const MapInfo &map);
+
+}
@@ -22,26 +22,119 @@
 
 #include "GameManager.hpp"
 
+#include <chrono>
+#include <memory>
 #include <utility>
 
 #include "HitObjects.hpp"
 #include "Math.hpp"
 #include "Util.hpp"
 
+#ifndef HEADLESS
 #include "imgui.h"
+#endif
+
+#define MAKE_CASE(TYPE, POOL)                                                   \
+  case HitObjectType::TYPE:                                                     \
+    object = pools->POOL.acquire(templates.make##TYPE(index), nextArguments);   \
+    break;
 
-#define MAKE_CASE(TYPE)                                                         \
-  case HitObjectType::TYPE: {                                                   \
-    auto object = std::make_shared<TYPE>(                                       \
-        std::static_pointer_cast<ObjectTemplate##TYPE>(objectTemplate), args);  \
-    object->create(skin);                                                       \
-    activeObjects.push_back(object);                                            \
-    break;                                                                      \
-  }
+#define RELEASE_CASE(TYPE, POOL)                                                \
+  case HitObjectType::TYPE:                                                     \
+    pools->POOL.release(static_cast<TYPE *>(object));                           \
+    break;
 
 namespace PROJECT_NAMESPACE
 {
 
+// Objects per allocation of a hit object pool.
+constexpr size_t OBJECT_POOL_CHUNK_SIZE = 32;
+
+/**
+ * Storage for the hit objects of one type. Objects are allocated in chunks and never move, sliders keep
+ * iterators into their own path. Released objects are destroyed right away and their slot is reused by
+ * the next object acquired, every object has to be released before the pool goes away.
+ */
+template<typename ObjectT>
+class HitObjectPool
+{
+public:
+    template<typename... ArgsT>
+    ObjectT *acquire(ArgsT &&... args)
+    {
+        void *slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if (slots == chunks.size() * OBJECT_POOL_CHUNK_SIZE) {
+                chunks.push_back(std::make_unique<Slot[]>(OBJECT_POOL_CHUNK_SIZE));
+            }
+            slot = chunks[slots / OBJECT_POOL_CHUNK_SIZE][slots % OBJECT_POOL_CHUNK_SIZE].data;
+            slots++;
+        }
+        return std::construct_at(static_cast<ObjectT *>(slot), std::forward<ArgsT>(args)...);
+    }
+
+    void release(ObjectT *object)
+    {
+        std::destroy_at(object);
+        freeSlots.push_back(object);
+    }
+
+    /// Frees the memory of the pool, every object has to be released beforehand.
+    void clear()
+    {
+        chunks.clear();
+        freeSlots.clear();
+        slots = 0;
+    }
+
+    /// Amount of objects currently alive.
+    [[nodiscard]] size_t size() const
+    {
+        return slots - freeSlots.size();
+    }
+
+    /// Amount of objects the pool has room for without allocating.
+    [[nodiscard]] size_t capacity() const
+    {
+        return chunks.size() * OBJECT_POOL_CHUNK_SIZE;
+    }
+
+private:
+    struct Slot
+    {
+        alignas(ObjectT) std::byte data[sizeof(ObjectT)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    std::vector<void *> freeSlots;
+    size_t slots{0};
+};
+
+struct HitObjectPools
+{
+    HitObjectPool<Note> notes;
+    HitObjectPool<Slider> sliders;
+    HitObjectPool<Spinner> spinners;
+
+    void clear()
+    {
+        notes.clear();
+        sliders.clear();
+        spinners.clear();
+    }
+};
+
+size_t HitObjectPrepareTask::operator()(const std::vector<BaseHitObject *> &objects) const
+{
+    for (auto *object : objects) {
+        object->prepare();
+    }
+    return objects.size();
+}
+
 double GameManager::getCurrentTime() const
 { return currentTime; }
 
@@ -49,12 +142,18 @@ void GameManager::setCurrentTime(double newTime)
 {
     currentTime = newTime;
 
-    for (auto &obj : activeObjects) {
-        obj->reset();
-        obj->update();
+    if (!info) {
+        return;
     }
 
-    last = activeObjects.begin();
+    // start over at the first object which hasn't ended yet
+    auto first = std::lower_bound(passTimes.begin(), passTimes.end(), newTime);
+    seekObjects(size_t(first - passTimes.begin()));
+    loadObjects();
+
+    for (auto *obj : activeObjects) {
+        obj->update();
+    }
 }
 
 void GameManager::update(double deltaIn)
@@ -62,22 +161,26 @@ void GameManager::update(double deltaIn)
     delta = deltaIn;
     currentTime += delta;
 
-    auto active = getClosestActiveObject();
+    // objects before last are done for good, hand them back to the pools
+    releaseObjects(last);
+    loadObjects();
+
+    size_t active = getClosestActiveObject() - activeObjects.cbegin();
 
     // objects are sorted by order of appearance
     int updates = 0;
     printCounter++;
     auto start = std::chrono::high_resolution_clock::now();
 
-    for (auto it = last;; it++) {
-        if (it == activeObjects.end()) {
+    for (size_t i = last;; i++) {
+        if (i == activeObjects.size()) {
             return;
         }
 
-        auto &obj = *it;
+        auto *obj = activeObjects[i];
 
         obj->update();
-        if (it == active) {
+        if (i == active) {
             input->update(*this);
         }
 
@@ -95,15 +198,15 @@ void GameManager::update(double deltaIn)
                 // Therefore, we will set the object after this as the next "last"
                 // object. The onUpdate loop will then start with that object,
                 // ignoring all objects before, who we've assumed to already be done.
-                auto nextIt = std::next(it);
-                if (last != nextIt) {
-                    if (nextIt == activeObjects.end()) {
-                        // first check if nextIt is the end, if it is so
+                auto next = i + 1;
+                if (last != next) {
+                    if (next == activeObjects.size()) {
+                        // first check if next is the end, if it is so
                         // just set it without checking for time as that would
-                        // cause access violation
-                        last = activeObjects.end();
-                    } else if ((*last)->getEndTime() < (*nextIt)->getEndTime()) {
-                        last = nextIt;
+                        // read past the end of the objects
+                        last = next;
+                    } else if (activeObjects[last]->getEndTime() < activeObjects[next]->getEndTime()) {
+                        last = next;
                     }
                 }
                 continue;
@@ -145,8 +248,9 @@ void GameManager::update(double deltaIn)
             }
                 // The object cannot be interacted with in these states
             case HitObjectState::PICKUP: {
-                auto score = obj->finish();
-                log::Info("SCORE: ", (int) score);
+                auto result = obj->finish();
+                log::Debug("SCORE: ", (int) result);
+                judge(firstTemplate + i, result);
                 break;
             }
             case HitObjectState::FADING:
@@ -179,6 +283,7 @@ void GameManager::update(double deltaIn)
 
 }
 
+#ifndef HEADLESS
 void GameManager::draw(video::LambdaRender &gfx)
 {
     gfx.draw(
@@ -188,6 +293,7 @@ void GameManager::draw(video::LambdaRender &gfx)
             double UPS = 1000000.0 / averageUT;
             ImGui::SameLine();
             ImGui::Text("UPS: %f", UPS);
+            ImGui::Text("Objects: %zu (%zu pending)", activeObjects.size(), pending.size());
 
             ImGui::PlotLines("History (UT)", history.data(), history.size(), 0, nullptr, minUT, maxUT);
         }, "Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse}
@@ -195,7 +301,7 @@ void GameManager::draw(video::LambdaRender &gfx)
 
     // the "last" object should be the next visible object in line
     // we therefore draw every object until we hit one that is invisible
-    if (last == activeObjects.end()) {
+    if (last == activeObjects.size()) {
         return;
     }
 
@@ -203,50 +309,41 @@ void GameManager::draw(video::LambdaRender &gfx)
     // this is done so that the most relevant objects are always on top
 
     // first find the last object that would be drawn
-    auto end = std::find_if(
-        last, activeObjects.end(), [](const std::shared_ptr<BaseHitObject> &obj)
-        {
-            return (obj->getState() == HitObjectState::INVISIBLE) && !obj->isFinished();
+    auto end = last;
+    while (end < activeObjects.size()) {
+        auto *obj = activeObjects[end];
+        if ((obj->getState() == HitObjectState::INVISIBLE) && !obj->isFinished()) {
+            break;
         }
-    );
-
-    // render everything from the object before last to the current object
-
-    // MSVC has a hissy fit every time we decrement a begin iterator,
-    // therefore we have to complicate things
-#ifdef WINDOWS
-    if (end == activeObjects.begin()) {
-        return;
-    }
-
-    if (last != activeObjects.begin()) {
-        last--;
+        end++;
     }
 
-    for (auto it = std::prev(end); it != last; it--) {
-#else
-    for (auto it = std::prev(end); it != std::prev(last); it--) {
-#endif
-        auto ptr = *it;
-        ptr->draw(gfx);
-    }
-#ifdef WINDOWS
-    if (last == activeObjects.begin()) {
-        activeObjects.front()->draw(gfx);
+    // render everything from the object before end down to last
+    for (auto i = end; i-- > last;) {
+        activeObjects[i]->draw(gfx);
     }
-#endif
 }
+#endif
 
 bool GameManager::setMap(Resource<MapInfo> map)
 {
+    seekObjects(0);
+    pools->clear();
+
+    // objects are only created once they come up, nothing to do until the first update
     info = std::move(map);
-    activeObjects.clear();
 
+    passTimes.clear();
     if (info) {
-        const auto &objs = info->getObjectTemplates();
-        lastLoadedObject = objs.begin();
-        loadObjects(objs.size());
+        auto endTimes = info->getObjectTemplates().getEndTimes();
+        passTimes.reserve(endTimes.size());
+        for (auto endTime : endTimes) {
+            passTimes.push_back(passTimes.empty() ? endTime : math::Max(passTimes.back(), endTime));
+        }
     }
+    judgements.assign(passTimes.size(), std::nullopt);
+    snapshots.assign(1, GameplaySnapshot{});
+    score = {};
 
     return true;
 }
@@ -261,11 +358,14 @@ void GameManager::reset()
         currentTime = 0.0;
     }
 
-    for (auto &object : activeObjects) {
-        object->reset();
-    }
+    std::fill(judgements.begin(), judgements.end(), std::nullopt);
+    snapshots.assign(1, GameplaySnapshot{});
+    seekObjects(0);
 
-    last = activeObjects.begin();
+#ifndef HEADLESS
+    if (!skin) {
+        return;
+    }
 
     samples.hit = skin->getSound(HIT_SOUND);
     samples.miss = skin->getSound(MISS_SOUND);
@@ -274,6 +374,7 @@ void GameManager::reset()
     samples.sliderBreak = skin->getSound(SLIDER_BREAK_SOUND);
     samples.spinnerSwoosh = skin->getSound(SPINNER_SWOOSH_SOUND);
     samples.spinnerDing = skin->getSound(SPINNER_DING_SOUND);
+#endif
 }
 
 const frect &GameManager::getPlayField() const
@@ -333,14 +434,29 @@ float GameManager::getHpDrain() const
     return 0.0f;
 }
 
+#ifndef HEADLESS
 const SampleSet &GameManager::getSamples() const
 {
     return samples;
 }
+#endif
+
+const ScoreState &GameManager::getScore() const
+{
+    return score;
+}
+
+const std::vector<std::optional<HitResult>> &GameManager::getJudgements() const
+{
+    return judgements;
+}
 
 bool GameManager::isFinished() const
 {
-    return last == activeObjects.end();
+    if (last != activeObjects.size() || !pending.empty()) {
+        return false;
+    }
+    return !info || (nextTemplate == info->getObjectTemplates().size());
 }
 
 bool GameManager::resolveFunction(HitObjectFunction func, const BaseHitObject &object) const
@@ -409,33 +525,30 @@ void GameManager::setInputMapper(std::unique_ptr<InputMapper> &&mapper)
     input = std::move(mapper);
 }
 
-std::weak_ptr<BaseHitObject> GameManager::getCurrentObject() const
+BaseHitObject *GameManager::getCurrentObject() const
 {
-    if (last != activeObjects.end()) {
-        return *last;
+    if (last < activeObjects.size()) {
+        return activeObjects[last];
     }
-    return {};
+    return nullptr;
 }
 
 GameManager::StorageT::const_iterator GameManager::getClosestActiveObject() const
 {
-    auto it = last;
-
-    while (it != activeObjects.end()) {
-        if (!(*it)->isFinished()) {
-            return it;
+    for (auto i = last; i < activeObjects.size(); i++) {
+        if (!activeObjects[i]->isFinished()) {
+            return activeObjects.begin() + i;
         }
-        it = std::next(it);
     }
     return activeObjects.end();
 }
 
-std::weak_ptr<BaseHitObject> GameManager::getNextObject() const
+BaseHitObject *GameManager::getNextObject() const
 {
-    if ((last != activeObjects.end()) && (std::next(last) != activeObjects.end())) {
-        return *std::next(last);
+    if ((last + 1) < activeObjects.size()) {
+        return activeObjects[last + 1];
     }
-    return {};
+    return nullptr;
 }
 
 const GameManager::StorageT &GameManager::getStoredObjects() const
@@ -451,56 +564,223 @@ fvec2d GameManager::getCursorPosition() const
     return {0, 0};
 }
 
-GameManager::GameManager()
+GameManager::GameManager() :
+    pools(std::make_unique<HitObjectPools>())
+{}
+
+GameManager::~GameManager()
 {
-    last = activeObjects.begin();
+    seekObjects(0);
 }
 
-unsigned int GameManager::loadObjects(unsigned int amount)
+void GameManager::setLookahead(double seconds)
 {
-    HitObjectArguments args;
-    args.mapSeed = 0;
+    lookahead = math::Max(seconds, 0.0);
+}
+
+double GameManager::getLookahead() const
+{
+    return lookahead;
+}
 
-    auto &templates = info->getObjectTemplates();
+BaseHitObject *GameManager::makeObject(size_t index)
+{
+    const auto &templates = info->getObjectTemplates();
+    auto types = templates.getTypes();
+
+    BaseHitObject *object;
+    switch (types[index]) {
+        MAKE_CASE(Spinner, spinners)
+        MAKE_CASE(Slider, sliders)
+        MAKE_CASE(Note, notes)
+        default: log::Warning("Corrupted map template: ", index);
+            return nullptr;
+    }
+    object->game = this;
 
-    if (templates.end() == lastLoadedObject) {
-        return 0;
+    if (bool(templates.getParameters()[index] & HitObjectParams::COMBO_END)) {
+        nextArguments.comboSeed++;
     }
+    nextArguments.objectSeed++;
+
+    return object;
+}
 
-    unsigned int loaded = 0;
-    auto it = lastLoadedObject;
-    for (it = lastLoadedObject; (it != templates.end()) && (loaded < amount); loaded++, it++) {
-        const auto &objectTemplate = *it;
+void GameManager::releaseObjects(size_t amount)
+{
+    if (amount == 0) {
+        return;
+    }
 
-        switch (objectTemplate->getType()) {
-            MAKE_CASE(Spinner)
-            MAKE_CASE(Slider)
-            MAKE_CASE(Note)
-            default: info = nullptr;
-                log::Warning("Corrupted map template: ", objectTemplate);
-                return false;
+    auto types = info->getObjectTemplates().getTypes();
+    for (size_t i = 0; i < amount; i++) {
+        auto *object = activeObjects[i];
+        switch (types[firstTemplate + i]) {
+            RELEASE_CASE(Spinner, spinners)
+            RELEASE_CASE(Slider, sliders)
+            RELEASE_CASE(Note, notes)
+            default: break;
         }
+    }
+
+    activeObjects.erase(activeObjects.begin(), activeObjects.begin() + amount);
+    firstTemplate += amount;
+    last -= amount;
+}
 
-        if (bool(objectTemplate->parameters & HitObjectParams::COMBO_END)) {
-            args.comboSeed++;
+void GameManager::loadObjects()
+{
+    if (!info) {
+        return;
+    }
+
+    const auto &templates = info->getObjectTemplates();
+    auto startTimes = templates.getStartTimes();
+    auto approachTime = getApproachTime();
+
+    auto adopt = [this](BaseHitObject *object)
+    {
+#ifndef HEADLESS
+        // without a skin the objects are only simulated, never drawn
+        if (skin) {
+            object->create(skin);
         }
-        args.objectSeed++;
+#endif
+        object->reset();
+        activeObjects.push_back(object);
+    };
+
+    // take over the prepared batch once it's done, or wait on it if its first object is about to show up
+    if (!pending.empty()) {
+        bool due = (startTimes[nextTemplate - pending.size()] - approachTime) <= currentTime;
+        if (!preparing.isComplete() && !due) {
+            return;
+        }
+        (void)preparing.waitResult();
+        for (auto *object : pending) {
+            adopt(object);
+        }
+        pending.clear();
     }
 
-    lastLoadedObject = it;
+    // objects which are already due but haven't been queued are created right away
+    while ((nextTemplate < templates.size()) && ((startTimes[nextTemplate] - approachTime) <= currentTime)) {
+        auto *object = makeObject(nextTemplate);
+        if (!object) {
+            seekObjects(0);
+            info = nullptr;
+            return;
+        }
+        nextTemplate++;
+        object->prepare();
+        adopt(object);
+    }
 
-    if (lastLoadedObject != templates.end()) {
-        lastLoadedObject++;
+    // queue up everything within the lookahead for the pool
+    while (
+        (nextTemplate < templates.size()) && (pending.size() < OBJECT_PREPARE_BATCH_SIZE) &&
+        ((startTimes[nextTemplate] - approachTime) <= (currentTime + lookahead))
+        ) {
+        auto *object = makeObject(nextTemplate);
+        if (!object) {
+            seekObjects(0);
+            info = nullptr;
+            return;
+        }
+        nextTemplate++;
+        pending.push_back(object);
     }
 
-    log::Debug("Loaded ", loaded, " objects");
+    // the batch has to be done by the time its first object enters the approach window
+    if (!pending.empty()) {
+        auto untilDue = math::Max(startTimes[nextTemplate - pending.size()] - approachTime - currentTime, 0.0);
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(untilDue));
+        preparing = tasks::MakeSimple(
+            {tasks::Priority::Interactive, deadline}, HitObjectPrepareTask(), std::vector<BaseHitObject *>(pending));
+    }
+}
+
+void GameManager::seekObjects(size_t index)
+{
+    // the pool may still be working on the pending objects
+    (void)preparing.waitResult();
+    preparing = {};
+
+    for (auto *object : pending) {
+        activeObjects.push_back(object);
+    }
+    pending.clear();
+
+    if (info) {
+        last = activeObjects.size();
+        releaseObjects(activeObjects.size());
+    }
+    activeObjects.clear();
+    last = 0;
+
+    firstTemplate = index;
+    nextTemplate = index;
+    nextArguments = {};
+    nextArguments.objectSeed = index;
+    score = {};
+
+    if (info) {
+        auto snapshot = findSnapshot(index);
+        nextArguments.comboSeed = snapshot.comboSeed;
+        score = snapshot.score;
+    }
+}
 
-    return loaded;
+void GameManager::judge(size_t index, HitResult result)
+{
+    judgements[index] = result;
+    score.add(result);
+
+    // every snapshot after this object is out of date now
+    snapshots.resize(math::Min(snapshots.size(), index / SNAPSHOT_INTERVAL + 1));
+}
+
+GameplaySnapshot GameManager::findSnapshot(size_t index)
+{
+    auto parameters = info->getObjectTemplates().getParameters();
+
+    auto advance = [&](GameplaySnapshot &snapshot, size_t from, size_t to)
+    {
+        for (size_t i = from; i < to; i++) {
+            if (judgements[i]) {
+                snapshot.score.add(*judgements[i]);
+            }
+            if (bool(parameters[i] & HitObjectParams::COMBO_END)) {
+                snapshot.comboSeed++;
+            }
+        }
+    };
+
+    // snapshots past the last judgement get rebuilt on demand
+    while ((snapshots.size() * SNAPSHOT_INTERVAL) <= index) {
+        auto snapshot = snapshots.back();
+        size_t from = (snapshots.size() - 1) * SNAPSHOT_INTERVAL;
+        advance(snapshot, from, from + SNAPSHOT_INTERVAL);
+        snapshots.push_back(snapshot);
+    }
+
+    size_t closest = index / SNAPSHOT_INTERVAL;
+    auto snapshot = snapshots[closest];
+    advance(snapshot, closest * SNAPSHOT_INTERVAL, index);
+    return snapshot;
 }
 
 void GameManager::skipToFirst()
 {
-    currentTime = (*last)->getStartTime() - 3.0f;
+    if (!info) {
+        return;
+    }
+
+    auto startTimes = info->getObjectTemplates().getStartTimes();
+    if ((firstTemplate + last) < startTimes.size()) {
+        currentTime = startTimes[firstTemplate + last] - 3.0f;
+    }
 }
 
 void GameManager::scrobble(double amount)
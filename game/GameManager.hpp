@@ -27,11 +27,21 @@
 #include "Keyboard.hpp"
 #include "MapInfo.hpp"
 #include "Mouse.hpp"
+#include "InputMapper.hpp"
+#include "Enum.hpp"
+#include "HitObjectArguments.hpp"
+#include "Tasks.hpp"
+
+// The headless build only runs the game logic, it has no skins, sounds or renderer.
+#ifndef HEADLESS
 #include "SoundStream.hpp"
 #include "Skin.hpp"
-#include "InputMapper.hpp"
+#endif
 
-#include <list>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <vector>
 
 namespace PROJECT_NAMESPACE {
 
@@ -47,8 +57,69 @@ constexpr const char *MISS_SOUND = "miss_sound";
 
 constexpr const char *COMBO_BREAK_SOUND = "combo_break_sound";
 
+// How long before entering the approach window hit objects get created, in seconds.
+constexpr double DEFAULT_OBJECT_LOOKAHEAD = 2.0;
+
+// Upper bound of hit objects prepared by a single pool task.
+constexpr size_t OBJECT_PREPARE_BATCH_SIZE = 64;
+
+// Hit objects between two gameplay snapshots.
+constexpr size_t SNAPSHOT_INTERVAL = 64;
+
+// Points given for every HitResult, before the combo bonus.
+constexpr std::array<unsigned int, 4> HIT_VALUES{0, 50, 100, 300};
+
 class BaseHitObject;
 
+struct HitObjectPools;
+
+/**
+ * Runs the skin independent part of hit object creation for a batch of objects which aren't in play yet.
+ */
+struct HitObjectPrepareTask
+{
+	using ResultType = tasks::Result<tasks::detail::TaskHolder<size_t, HitObjectPrepareTask>>;
+
+	size_t operator()(const std::vector<BaseHitObject *> &objects) const;
+};
+
+/**
+ * Score and combo of a play.
+ */
+struct ScoreState
+{
+	uint64_t score{0};
+	unsigned int combo{0};
+	unsigned int maxCombo{0};
+	// Amount of every HitResult, indexed by the result.
+	std::array<unsigned int, HIT_VALUES.size()> results{};
+
+	void add(HitResult result)
+	{
+		auto value = HIT_VALUES[size_t(result)];
+		results[size_t(result)]++;
+
+		if (result == HitResult::MISSED) {
+			combo = 0;
+			return;
+		}
+
+		score += value + (uint64_t(value) * combo) / 25;
+		combo++;
+		maxCombo = std::max(maxCombo, combo);
+	}
+};
+
+/**
+ * State of the game right before a hit object, restored when seeking.
+ */
+struct GameplaySnapshot
+{
+	ScoreState score;
+	unsigned int comboSeed{0};
+};
+
+#ifndef HEADLESS
 struct SampleSet
 {
 	Resource<SoundSample> hit;
@@ -60,17 +131,23 @@ struct SampleSet
 	Resource<SoundSample> spinnerSwoosh;
 	Resource<SoundSample> spinnerDing;
 };
+#endif
 
 class GameManager
 {
 public:
-	using StorageT = std::list<std::shared_ptr<BaseHitObject>>;
+	// Hit objects around the current time in order of appearance, pointing into the per type pools.
+	using StorageT = std::vector<BaseHitObject *>;
 
 	explicit GameManager();
 
+	virtual ~GameManager();
+
 	virtual void update(double delta);
 
+#ifndef HEADLESS
 	virtual void draw(video::LambdaRender& gfx);
+#endif
 
 	[[nodiscard]] double getCurrentTime() const;
 
@@ -106,41 +183,86 @@ public:
 
 	[[nodiscard]] float getStartOffset() const;
 
+#ifndef HEADLESS
 	[[nodiscard]] const SampleSet &getSamples() const;
+#endif
+
+	[[nodiscard]] const ScoreState &getScore() const;
+
+	/// Judgement of every object template of the map, empty for objects which haven't been judged yet.
+	[[nodiscard]] const std::vector<std::optional<HitResult>> &getJudgements() const;
 
 	[[nodiscard]] bool isFinished() const;
 
 	void setInputMapper(std::unique_ptr<InputMapper> &&mapper);
 
-	[[nodiscard]] std::weak_ptr<BaseHitObject> getCurrentObject() const;
+	/**
+	 * Sets how far ahead of their approach window hit objects get created.
+	 * @param seconds Time before an object starts approaching, in seconds.
+	 */
+	void setLookahead(double seconds);
+
+	[[nodiscard]] double getLookahead() const;
+
+	[[nodiscard]] BaseHitObject *getCurrentObject() const;
 
 	[[nodiscard]] GameManager::StorageT::const_iterator getClosestActiveObject() const;
 
-	[[nodiscard]] std::weak_ptr<BaseHitObject> getNextObject() const;
+	[[nodiscard]] BaseHitObject *getNextObject() const;
 
 	[[nodiscard]] const StorageT &getStoredObjects() const;
 
     [[nodiscard]] double getDelta() const;
 
+#ifndef HEADLESS
     void setSkin(Resource<Skin>);
+#endif
 
 private:
-	unsigned int loadObjects(unsigned int amount);
+	BaseHitObject *makeObject(size_t index);
+	void releaseObjects(size_t amount);
+	void loadObjects();
+	void seekObjects(size_t index);
+	void judge(size_t index, HitResult result);
+	[[nodiscard]] GameplaySnapshot findSnapshot(size_t index);
 	[[nodiscard]] bool resolveFunction(HitObjectFunction func, const BaseHitObject &object) const;
 
+#ifndef HEADLESS
     // FIXME: need to somehow pass the skin to this point
     Resource<Skin> skin;
+#endif
     double delta{};
 	std::unique_ptr<InputMapper> input{nullptr};
-	StorageT::iterator last{};
+	// Index of the first object which may still need updating.
+	size_t last{0};
 	StorageT activeObjects{};
+	// Owns every hit object, objects which have been passed are handed back and reused further ahead.
+	std::unique_ptr<HitObjectPools> pools;
+	// Objects queued up right after activeObjects, they're being prepared on the pool.
+	std::vector<BaseHitObject *> pending{};
+	HitObjectPrepareTask::ResultType preparing{};
 	Resource<MapInfo> info{nullptr};
+#ifndef HEADLESS
 	SampleSet samples{};
+#endif
 	Mat3f transform{MAT3_NO_TRANSFORM<float>};
 	frect playField{UNIT_RECT<float>};
 	double currentTime{0.0};
 
-	MapInfo::StorageT::const_iterator lastLoadedObject;
+	// Index of the object template activeObjects starts at.
+	size_t firstTemplate{0};
+	// Index of the first object template which doesn't have a hit object yet.
+	size_t nextTemplate{0};
+	HitObjectArguments nextArguments{};
+	double lookahead{DEFAULT_OBJECT_LOOKAHEAD};
+
+	// Latest end time of the object templates up to every index, sorted, so seeking is a binary search.
+	std::vector<double> passTimes{};
+	// Judgement of every object template, if it has been judged during this play.
+	std::vector<std::optional<HitResult>> judgements{};
+	// Snapshot of the game right before every SNAPSHOT_INTERVAL-th object, only valid up to the last judgement.
+	std::vector<GameplaySnapshot> snapshots{};
+	ScoreState score{};
 
 	float arMultiplier{1.0f};
 	float csMultiplier{1.0f};
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+/*
+    HeadlessMain.cpp
+
+    Entry point of the headless build, plays a map with the autopilot without opening a window or an audio device.
+    Built from the game logic alone, off by default, configure with -DBUILD_HEADLESS=ON to get it.
+
+    Usage: osupp-headless <map> [--rate <updates per second>] [--log <file>] [--compare <file>] [--record <file>]
+                          [--replay <file>]
+
+    --log writes the judgement of every hit object to a file, --compare checks the judgements against a log written
+    earlier and fails if they differ, so a known good log works as a regression test.
+    --record saves the input as a replay, --replay plays one back instead of the autopilot.
+ */
+
+#include "Simulation.hpp"
+#include "AutoPilot.hpp"
+#include "ReplayInput.hpp"
+#include "ReplayRecorder.hpp"
+#include "Program.hpp"
+#include "Error.hpp"
+#include "Log.hpp"
+#include "Math.hpp"
+#include "Tasks.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace PROJECT_NAMESPACE;
+
+// Updates per simulated second, unless given with --rate.
+constexpr unsigned int DEFAULT_SIMULATION_RATE = 1000;
+
+int main(int argc, char **argv)
+{
+    error::detail::InstallHandler();
+    log::detail::Init();
+
+    std::filesystem::path mapPath;
+    std::filesystem::path logPath;
+    std::filesystem::path comparePath;
+    std::filesystem::path recordPath;
+    std::filesystem::path replayPath;
+    unsigned int rate = DEFAULT_SIMULATION_RATE;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = (i + 1) < argc;
+
+        if (argument == "--rate" && hasValue) {
+            rate = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--log" && hasValue) {
+            logPath = argv[++i];
+        } else if (argument == "--compare" && hasValue) {
+            comparePath = argv[++i];
+        } else if (argument == "--record" && hasValue) {
+            recordPath = argv[++i];
+        } else if (argument == "--replay" && hasValue) {
+            replayPath = argv[++i];
+        } else if (mapPath.empty()) {
+            mapPath = argument;
+        } else {
+            log::Error("Unexpected argument ", argument);
+            return 1;
+        }
+    }
+
+    if (mapPath.empty() || rate == 0) {
+        log::Error("Usage: ", argv[0], " <map> [--rate <updates per second>] [--log <file>] [--compare <file>] "
+                   "[--record <file>] [--replay <file>]");
+        return 1;
+    }
+
+    tasks::Start();
+
+    auto map = Load<MapInfo>(mapPath);
+    if (!map) {
+        log::Error("Failed to load ", mapPath);
+        core::Exit(1);
+    }
+
+    GameManager game;
+    game.setMap(map);
+
+    std::unique_ptr<InputMapper> input;
+    if (!replayPath.empty()) {
+        input = LoadReplay(replayPath);
+        if (!input) {
+            core::Exit(1);
+        }
+    } else {
+        input = std::make_unique<AutoPilot>();
+    }
+
+    // the simulation takes the input over, keep a hold of the recorder to save it afterwards
+    ReplayRecorder *recorder = nullptr;
+    if (!recordPath.empty()) {
+        auto wrapped = std::make_unique<ReplayRecorder>(std::move(input));
+        recorder = wrapped.get();
+        input = std::move(wrapped);
+    }
+
+    auto result = Simulate(game, std::move(input), rate);
+    const auto &score = result.score;
+
+    log::Info(
+        "Simulated ", result.simulatedTime, "s in ", result.wallTime, "s (",
+        result.simulatedTime / math::Max(result.wallTime, 1e-9), " simulated seconds per second, ",
+        result.updates, " updates)"
+    );
+    log::Info(
+        "Score ", score.score, ", max combo ", score.maxCombo, ", 300: ", score.results[size_t(HitResult::HIT300)],
+        ", 100: ", score.results[size_t(HitResult::HIT100)], ", 50: ", score.results[size_t(HitResult::HIT50)],
+        ", miss: ", score.results[size_t(HitResult::MISSED)]
+    );
+
+    if (recorder) {
+        if (!recorder->save(recordPath)) {
+            core::Exit(1);
+        }
+        log::Info("Recorded ", recorder->getData().size(), " bytes of replay to ", recordPath);
+    }
+
+    std::ostringstream judgements;
+    WriteJudgementLog(judgements, game);
+
+    if (!logPath.empty()) {
+        std::ofstream out(logPath);
+        out << judgements.str();
+        if (!out) {
+            log::Error("Failed to write ", logPath);
+            core::Exit(1);
+        }
+    }
+
+    if (!comparePath.empty()) {
+        std::ifstream in(comparePath);
+        std::stringstream expected;
+        expected << in.rdbuf();
+        if (!in || (expected.str() != judgements.str())) {
+            log::Error("Judgements differ from ", comparePath);
+            core::Exit(1);
+        }
+        log::Info("Judgements match ", comparePath);
+    }
+
+    core::Exit(0);
+}
@@ -0,0 +1,412 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+
+#include "MapCache.hpp"
+
+#include "Log.hpp"
+#include "ZipArchive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#ifdef LINUX
+#include <sys/stat.h>
+#endif
+
+namespace PROJECT_NAMESPACE {
+
+namespace
+{
+
+constexpr char MAP_CACHE_MAGIC[8] = {'O', 'S', 'U', 'P', 'P', 'M', 'C', '\0'};
+
+struct FileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t entryCount;
+	uint64_t fileSize;
+};
+
+struct IndexEntry
+{
+	uint64_t pathOffset;
+	uint64_t pathLength;
+	uint64_t size;
+	int64_t modified;
+	uint64_t hash;
+	uint64_t headerOffset;
+	uint64_t headerLength;
+};
+
+class BinaryWriter
+{
+public:
+	explicit BinaryWriter(std::string &outIn) : out(outIn) {}
+
+	template<typename T>
+	requires std::is_trivially_copyable_v<T>
+	void write(const T &value)
+	{
+		out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	void write(std::string_view str)
+	{
+		write(uint32_t(str.size()));
+		out.append(str);
+	}
+
+private:
+	std::string &out;
+};
+
+class BinaryReader
+{
+public:
+	explicit BinaryReader(std::string_view inIn) : in(inIn) {}
+
+	template<typename T>
+	requires std::is_trivially_copyable_v<T>
+	bool read(T &value)
+	{
+		if (in.size() < sizeof(T)) {
+			failed = true;
+			return false;
+		}
+		std::memcpy(&value, in.data(), sizeof(T));
+		in.remove_prefix(sizeof(T));
+		return true;
+	}
+
+	bool read(std::string &str)
+	{
+		uint32_t length = 0;
+		if (!read(length) || in.size() < length) {
+			failed = true;
+			return false;
+		}
+		str.assign(in.data(), length);
+		in.remove_prefix(length);
+		return true;
+	}
+
+	[[nodiscard]] inline bool good() const { return !failed; }
+
+private:
+	std::string_view in;
+	bool failed{false};
+};
+
+void WriteHeader(const MapHeader &map, std::string &out)
+{
+	BinaryWriter writer(out);
+	writer.write(map.backgroundPath);
+	writer.write(map.name);
+	writer.write(map.romanisedName);
+	writer.write(map.description);
+	writer.write(map.artist);
+	writer.write(map.romanisedArtist);
+	writer.write(map.source);
+	writer.write(map.author);
+	writer.write(uint32_t(map.tags.size()));
+	for (const auto &tag : map.tags) {
+		writer.write(tag);
+	}
+	writer.write(map.difficulty);
+	writer.write(map.songPath);
+	writer.write(map.circleSize);
+	writer.write(map.startOffset);
+	writer.write(map.mapDuration);
+	writer.write(map.HPDrain);
+	writer.write(map.approachTime);
+	writer.write(map.hitWindow);
+	writer.write(map.fadeTime);
+	writer.write(map.overallDifficulty);
+	writer.write(map.starRating);
+}
+
+bool ReadHeader(std::string_view in, MapHeader &map)
+{
+	BinaryReader reader(in);
+	reader.read(map.backgroundPath);
+	reader.read(map.name);
+	reader.read(map.romanisedName);
+	reader.read(map.description);
+	reader.read(map.artist);
+	reader.read(map.romanisedArtist);
+	reader.read(map.source);
+	reader.read(map.author);
+	uint32_t tagCount = 0;
+	if (reader.read(tagCount)) {
+		// a corrupted count must not turn into a huge allocation
+		map.tags.resize(std::min<size_t>(tagCount, in.size()));
+		for (auto &tag : map.tags) {
+			reader.read(tag);
+		}
+	}
+	reader.read(map.difficulty);
+	reader.read(map.songPath);
+	reader.read(map.circleSize);
+	reader.read(map.startOffset);
+	reader.read(map.mapDuration);
+	reader.read(map.HPDrain);
+	reader.read(map.approachTime);
+	reader.read(map.hitWindow);
+	reader.read(map.fadeTime);
+	reader.read(map.overallDifficulty);
+	reader.read(map.starRating);
+	return reader.good();
+}
+
+/// Stamps a file on disk, returns nothing for anything but a regular file.
+std::optional<MapCache::Stamp> GetFileStamp(const std::filesystem::path &path)
+{
+#ifdef LINUX
+	// the library scan stamps every map, get the size and time out of a single stat
+	struct stat info{};
+	if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+		return {};
+	}
+
+	MapCache::Stamp stamp;
+	stamp.size = uint64_t(info.st_size);
+	stamp.modified = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+	return stamp;
+#else
+	std::error_code ec;
+	auto size = std::filesystem::file_size(path, ec);
+	if (ec) {
+		return {};
+	}
+	auto modified = std::filesystem::last_write_time(path, ec);
+	if (ec) {
+		return {};
+	}
+
+	MapCache::Stamp stamp;
+	stamp.size = size;
+	stamp.modified = int64_t(modified.time_since_epoch().count());
+	return stamp;
+#endif
+}
+
+}
+
+std::optional<MapCache::Stamp> MapCache::GetStamp(const std::filesystem::path &path)
+{
+	if (auto stamp = GetFileStamp(path)) {
+		return stamp;
+	}
+
+	// maps inside archives take the modification time of the archive and their own size
+	auto member = files::SplitArchivePath(path);
+	if (!member) {
+		return {};
+	}
+	auto archive = files::ZipArchive::Get(member->archive);
+	const auto *entry = archive ? archive->find(member->member) : nullptr;
+	auto stamp = entry ? GetFileStamp(member->archive) : std::nullopt;
+	if (stamp) {
+		stamp->size = entry->size;
+	}
+	return stamp;
+}
+
+uint64_t MapCache::Hash(std::string_view data)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (unsigned char c : data) {
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::optional<uint64_t> MapCache::HashFile(const std::filesystem::path &path)
+{
+	files::MappedFile mapped;
+	if (!mapped.open(path)) {
+		// archives already checksum their members
+		auto member = files::SplitArchivePath(path);
+		auto archive = member ? files::ZipArchive::Get(member->archive) : nullptr;
+		const auto *entry = archive ? archive->find(member->member) : nullptr;
+		if (!entry) {
+			return {};
+		}
+		return entry->crc;
+	}
+	return Hash(mapped.view());
+}
+
+MapCache::Record MapCache::MakeRecord(const MapHeader &header, std::string path, const Stamp &stamp)
+{
+	auto storage = std::make_shared<std::string>();
+	WriteHeader(header, *storage);
+
+	Record record;
+	record.path = std::move(path);
+	record.stamp = stamp;
+	record.header = *storage;
+	record.owner = std::move(storage);
+	return record;
+}
+
+bool MapCache::Read(const Entry &entry, const std::filesystem::path &path, MapHeader &header)
+{
+	header.path = path;
+	return ReadHeader(entry.header, header);
+}
+
+bool MapCache::Write(const std::filesystem::path &cacheFile, const std::vector<Record> &records)
+{
+	// Layout: file header, index, paths, all map headers.
+	uint64_t offset = sizeof(FileHeader) + sizeof(IndexEntry) * records.size();
+	std::vector<IndexEntry> index(records.size());
+
+	for (size_t i = 0; i < records.size(); i++) {
+		index[i].pathOffset = offset;
+		index[i].pathLength = records[i].path.size();
+		offset += records[i].path.size();
+	}
+	for (size_t i = 0; i < records.size(); i++) {
+		const auto &stamp = records[i].stamp;
+		index[i].size = stamp.size;
+		index[i].modified = stamp.modified;
+		index[i].hash = stamp.hash;
+		index[i].headerOffset = offset;
+		index[i].headerLength = records[i].header.size();
+		offset += records[i].header.size();
+	}
+
+	FileHeader header{};
+	std::memcpy(header.magic, MAP_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MAP_CACHE_VERSION;
+	header.entryCount = uint32_t(records.size());
+	header.fileSize = offset;
+
+	auto temporary = cacheFile;
+	temporary += ".tmp";
+
+	{
+		std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+		if (!ofs.is_open()) {
+			log::Warning("Unable to write map cache ", cacheFile);
+			return false;
+		}
+
+		ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		ofs.write(reinterpret_cast<const char *>(index.data()), std::streamsize(sizeof(IndexEntry) * index.size()));
+		for (const auto &record : records) {
+			ofs.write(record.path.data(), std::streamsize(record.path.size()));
+		}
+		for (const auto &record : records) {
+			ofs.write(record.header.data(), std::streamsize(record.header.size()));
+		}
+
+		if (!ofs.good()) {
+			log::Warning("Failed writing map cache ", cacheFile);
+			ofs.close();
+			std::filesystem::remove(temporary);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, cacheFile, ec);
+	if (ec) {
+		log::Warning("Unable to replace map cache ", cacheFile, ": ", ec.message());
+		std::filesystem::remove(temporary, ec);
+		return false;
+	}
+
+	return true;
+}
+
+bool MapCache::open(const std::filesystem::path &cacheFile)
+{
+	entries.clear();
+
+	if (!file.open(cacheFile)) {
+		return false;
+	}
+
+	auto data = file.view();
+
+	FileHeader header{};
+	if (data.size() < sizeof(header)) {
+		file.close();
+		return false;
+	}
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, MAP_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != MAP_CACHE_VERSION || header.fileSize != data.size() ||
+		(data.size() - sizeof(header)) / sizeof(IndexEntry) < header.entryCount) {
+		log::Info("Map cache ", cacheFile, " is outdated, it will be rebuilt");
+		file.close();
+		return false;
+	}
+
+	auto inRange = [&data](uint64_t offset, uint64_t length)
+	{ return offset <= data.size() && length <= data.size() - offset; };
+
+	entries.reserve(header.entryCount);
+	for (uint32_t i = 0; i < header.entryCount; i++) {
+		IndexEntry index{};
+		std::memcpy(&index, data.data() + sizeof(header) + i * sizeof(IndexEntry), sizeof(index));
+
+		if (!inRange(index.pathOffset, index.pathLength) || !inRange(index.headerOffset, index.headerLength)) {
+			log::Warning("Map cache ", cacheFile, " is corrupted, it will be rebuilt");
+			entries.clear();
+			file.close();
+			return false;
+		}
+
+		Entry entry;
+		entry.stamp.size = index.size;
+		entry.stamp.modified = index.modified;
+		entry.stamp.hash = index.hash;
+		entry.header = data.substr(index.headerOffset, index.headerLength);
+		entries.emplace(data.substr(index.pathOffset, index.pathLength), entry);
+	}
+
+	return true;
+}
+
+std::optional<MapCache::Entry> MapCache::find(std::string_view path) const
+{
+	auto it = entries.find(path);
+	if (it == entries.end()) {
+		return {};
+	}
+	return it->second;
+}
+
+size_t MapCache::size() const
+{
+	return entries.size();
+}
+
+}
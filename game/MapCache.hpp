@@ -0,0 +1,127 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+
+#pragma once
+
+#include "define.hpp"
+
+#include "Files.hpp"
+#include "MapInfo.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/// Name of the cache file kept in every songs directory.
+constexpr const char *MAP_CACHE_FILE = ".maps.cache";
+/// Bump whenever the cache layout or the serialized MapHeader fields change, older caches are then rebuilt.
+constexpr uint32_t MAP_CACHE_VERSION = 4;
+
+/**
+ * A compiled binary copy of the header of every map in a songs directory.
+ *
+ * The file holds a table of entries (path relative to the songs directory, size, modification time and content hash
+ * of the source file) followed by the serialized map headers. Hit objects are not cached, they are only parsed once a
+ * map is opened. The file is memory mapped on open, so looking entries up only touches the index.
+ */
+class MapCache
+{
+public:
+	/// Identifies the version of a map file the cached data was built from.
+	struct Stamp
+	{
+		uint64_t size{0};
+		// Platform specific modification time, only ever compared for equality.
+		int64_t modified{0};
+		// FNV-1a of the file contents, or the archive's CRC-32 for maps inside archives. Used when the modification time
+		// changed but the size did not.
+		uint64_t hash{0};
+	};
+
+	/// A cached map, views into the mapped cache file.
+	struct Entry
+	{
+		Stamp stamp;
+		std::string_view header;
+	};
+
+	/// A map to be written to a new cache file.
+	struct Record
+	{
+		std::string path;
+		Stamp stamp;
+		std::string_view header;
+		// Keeps whatever header points into alive.
+		std::shared_ptr<const void> owner;
+	};
+
+	/**
+	 * Reads the size and modification time of a file, the hash is left empty.
+	 * Maps inside archives get their own size and the modification time of the archive.
+	 */
+	static std::optional<Stamp> GetStamp(const std::filesystem::path &path);
+
+	/**
+	 * Hashes the contents of a file.
+	 * @return The hash or an empty optional if the file can't be read.
+	 */
+	static std::optional<uint64_t> HashFile(const std::filesystem::path &path);
+	static uint64_t Hash(std::string_view data);
+
+	/**
+	 * Serializes a map header into a record. The record owns its data.
+	 */
+	static Record MakeRecord(const MapHeader &header, std::string path, const Stamp &stamp);
+
+	/**
+	 * Rebuilds a map header from a cache entry.
+	 * @param entry Entry to read.
+	 * @param path Path of the map file.
+	 * @param header Header to fill in.
+	 * @return False if the entry is malformed.
+	 */
+	static bool Read(const Entry &entry, const std::filesystem::path &path, MapHeader &header);
+
+	/**
+	 * Writes a new cache file. The file is written next to its destination and then moved over it, so caches which
+	 * are still mapped stay intact.
+	 */
+	static bool Write(const std::filesystem::path &cacheFile, const std::vector<Record> &records);
+
+	bool open(const std::filesystem::path &cacheFile);
+
+	[[nodiscard]] std::optional<Entry> find(std::string_view path) const;
+	[[nodiscard]] size_t size() const;
+
+private:
+	files::MappedFile file;
+	std::unordered_map<std::string_view, Entry> entries;
+};
+
+}
@@ -25,7 +25,6 @@
 #include "HitObjects.hpp"
 #include "MapLoaders.hpp"
 #include "Util.hpp"
-#include "Skin.hpp"
 
 
 #include <fstream>
@@ -41,69 +40,36 @@ const MapInfo::StorageT &MapInfo::getObjectTemplates() const
 
 void MapInfo::addNote(const fvec2d &position, bool comboEnd, double time)
 {
-	auto object = std::make_shared<ObjectTemplateNote>();
-	object->startTime = time;
-	object->endTime = time;
-	object->position = position;
-	object->parameters |= comboEnd ? HitObjectParams::COMBO_END : HitObjectParams::NONE;
-	insertElement(object);
+	objectTemplates.addNote(position, comboEnd ? HitObjectParams::COMBO_END : HitObjectParams::NONE, time);
 }
 
 void MapInfo::addSlider(const SliderPathT &points, bool comboEnd, double time,
 						double endTime, math::CurveType type, unsigned int repeats)
 {
-	auto object = std::make_shared<ObjectTemplateSlider>();
-	object->startTime = time;
-	object->parameters |= comboEnd ? HitObjectParams::COMBO_END : HitObjectParams::NONE;
-	object->path = points;
-	object->endTime = endTime;
-	object->sliderType = type;
-	object->repeats = math::Max(repeats, 1);
-	insertElement(object);
+	objectTemplates.addSlider(
+		points, comboEnd ? HitObjectParams::COMBO_END : HitObjectParams::NONE, time, endTime, type,
+		math::Max(repeats, 1)
+	);
 }
 
 void MapInfo::addSpinner(float spinRequired, float spinResistance, double time,
 						 double endTime, const fvec2d &position)
 {
-	auto object = std::make_shared<ObjectTemplateSpinner>();
-	object->startTime = time;
-	object->spinRequired = spinRequired;
-	object->spinResistance = spinResistance;
-	object->endTime = endTime;
-	object->position = position;
-	if (position != fvec2d{0, 0}) {
-		object->free = true;
-	}
-	insertElement(object);
+	objectTemplates.addSpinner(spinRequired, spinResistance, time, endTime, position, position != fvec2d{0, 0});
 }
 
-void MapInfo::insertElement(std::shared_ptr<BaseObjectTemplate> obj)
+void MapInfo::clear()
 {
-    auto insertPoint =
-        std::find_if(
-            objectTemplates.begin(), objectTemplates.end(),
-            [&obj](const std::shared_ptr<BaseObjectTemplate> &checked)
-            {
-                return checked->startTime > obj->startTime;
-            }
-        );
-
-    if (insertPoint == objectTemplates.end()) {
-        objectTemplates.push_back(obj);
-    } else {
-        objectTemplates.insert(std::prev(insertPoint), obj);
-    }
+    objectTemplates.clear();
+    timing.clear();
 }
 
-void MapInfo::clear()
-{ objectTemplates.clear(); }
-
 template<>
 Resource<MapInfo> Load(const std::filesystem::path &path)
 {
 	Resource<MapInfo> r;
 
-	r->directory = path.parent_path();
+	r->path = path;
 
 	bool success;
 
@@ -117,6 +83,7 @@ Resource<MapInfo> Load(const std::filesystem::path &path)
 	}
 
 	if (success) {
+		r->objectTemplates.shrinkToFit();
 		return r;
 	}
 
@@ -124,9 +91,30 @@ Resource<MapInfo> Load(const std::filesystem::path &path)
 	return nullptr;
 }
 
-const std::filesystem::path &MapInfo::getDirectory() const
+bool LoadHeader(const std::filesystem::path &path, MapHeader &header)
+{
+	header.path = path;
+
+	if (path.extension() == ".osu") {
+		return LoadOSUHeader(path, header);
+	} else if (path.extension() == ".map") {
+		// .map files are small and keep their metadata interleaved with the objects, there is no shortcut for them
+		MapInfo map;
+		if (!LoadMAP(path, map)) {
+			return false;
+		}
+		map.path = path;
+		header = map;
+		return true;
+	}
+
+	log::Error("Unrecognized file type");
+	return false;
+}
+
+std::filesystem::path MapHeader::getDirectory() const
 {
-	return directory;
+	return path.parent_path();
 }
 
 }
\ No newline at end of file
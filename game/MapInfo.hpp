@@ -25,39 +25,29 @@
 #include "define.hpp"
 
 #include "BaseObjectTemplate.hpp"
+#include "ObjectTemplateStore.hpp"
 #include "Resource.hpp"
 #include "SliderTypes.hpp"
+#include "TimingTimeline.hpp"
 #include "Vector.hpp"
 
 #include <filesystem>
 #include <list>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace PROJECT_NAMESPACE {
 
-class MapInfo
+/**
+ * Everything song select needs to know about a map, readable without loading any of its hit objects.
+ */
+struct MapHeader
 {
-    friend Resource<MapInfo> Load<MapInfo>(const std::filesystem::path &);
-public:
-    using StorageT = std::list<std::shared_ptr<BaseObjectTemplate>>;
-
-    [[nodiscard]] const StorageT &getObjectTemplates() const;
-
-    [[nodiscard]] const std::filesystem::path &getDirectory() const;
+    [[nodiscard]] std::filesystem::path getDirectory() const;
 
-    void clear();
-
-    void addNote(const fvec2d &position, bool comboEnd, double time);
-
-    void addSlider(
-        const SliderPathT &points, bool comboEnd, double time,
-        double endTime, math::CurveType type, unsigned int repeats = 1
-    );
-
-    void addSpinner(
-        float spinRequired, float spinResistance, double time,
-        double endTime, const fvec2d &position = {0, 0}
-    );
+    // The file the map was loaded from.
+    std::filesystem::path path;
 
     std::string backgroundPath;
 
@@ -97,15 +87,49 @@ public:
     float hitWindow = 0.3f;
     // How long the objects linger on the screen after they've been hit.
     float fadeTime = 0.25f;
-    // The star difficulty of the map, used for display purposes only.
+    // Overall difficulty setting of the map, as written in the map file.
     float overallDifficulty = 0.0f;
+    // The star difficulty of the map, used for display purposes only. Negative until it has been calculated.
+    float starRating = -1.0f;
+};
+
+class MapInfo : public MapHeader
+{
+    friend Resource<MapInfo> Load<MapInfo>(const std::filesystem::path &);
+public:
+    using StorageT = ObjectTemplateStore;
+
+    [[nodiscard]] const StorageT &getObjectTemplates() const;
+
+    void clear();
+
+    // Tempo and velocity changes of the song, loaded along with the hit objects.
+    TimingTimeline timing;
+
+    void addNote(const fvec2d &position, bool comboEnd, double time);
+
+    void addSlider(
+        const SliderPathT &points, bool comboEnd, double time,
+        double endTime, math::CurveType type, unsigned int repeats = 1
+    );
+
+    void addSpinner(
+        float spinRequired, float spinResistance, double time,
+        double endTime, const fvec2d &position = {0, 0}
+    );
 
 private:
-    void insertElement(std::shared_ptr<BaseObjectTemplate>);
-    std::filesystem::path directory;
     StorageT objectTemplates;
 };
 
+/**
+ * Reads only the header of a map file.
+ * @param path Path to the map.
+ * @param header Header to fill in, its path is set as well.
+ * @return Whether the map could be read.
+ */
+bool LoadHeader(const std::filesystem::path &path, MapHeader &header);
+
 template<>
 Resource<MapInfo> Load(const std::filesystem::path &);
 
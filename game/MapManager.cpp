@@ -22,57 +22,539 @@
 #include "MapManager.hpp"
 
 #include "Tasks.hpp"
+#include "ZipArchive.hpp"
 
 #include <algorithm>
 
 namespace PROJECT_NAMESPACE {
 
+namespace
+{
+
+/// Maps are only read out of archives if they're .osu files, the only kind map sets are distributed with.
+const std::vector<std::string> ARCHIVED_MAP_EXTENSIONS = {".osu"};
+
+/// Loose maps and map set archives.
+const std::vector<std::string> &GetScannedExtensions()
+{
+	static const std::vector<std::string> extensions = []()
+	{
+		auto all = Resource<MapInfo>::allowedExtensions;
+		const auto &archives = files::GetArchiveExtensions();
+		all.insert(all.end(), archives.begin(), archives.end());
+		return all;
+	}();
+	return extensions;
+}
+
+void ScanArchive(const std::filesystem::path &root, const std::filesystem::path &path, std::vector<ScannedMap> &maps)
+{
+	auto archive = files::ZipArchive::Get(path);
+	auto stamp = archive ? MapCache::GetStamp(path) : std::nullopt;
+	if (!stamp) {
+		return;
+	}
+
+	for (const auto &entry : archive->getEntries()) {
+		if (!files::HasExtension(entry.name, ARCHIVED_MAP_EXTENSIONS)) {
+			continue;
+		}
+		ScannedMap map;
+		map.path = path / entry.name;
+		map.key = map.path.lexically_relative(root).generic_string();
+		map.stamp = *stamp;
+		map.stamp.size = entry.size;
+		maps.push_back(std::move(map));
+	}
+}
+
+}
+
+ScannedMaps MapScanTask::operator()(const MapScanRequest &request) const
+{
+	ScannedMaps scanned;
+	scanned.library = request.library;
+	scanned.fullScan = request.fullScan;
+
+	std::vector<std::filesystem::path> found(request.files);
+	std::vector<std::filesystem::path> pending(request.directories.rbegin(), request.directories.rend());
+	while (!pending.empty()) {
+		auto directory = std::move(pending.back());
+		pending.pop_back();
+		files::ListDirectory(directory, GetScannedExtensions(), found, &pending);
+	}
+
+	scanned.maps.reserve(found.size());
+	for (auto &path : found) {
+		if (files::HasExtension(path.filename().string(), files::GetArchiveExtensions())) {
+			ScanArchive(request.root, path, scanned.maps);
+			continue;
+		}
+
+		auto stamp = MapCache::GetStamp(path);
+		if (!stamp) {
+			continue;
+		}
+		ScannedMap map;
+		map.key = path.lexically_relative(request.root).generic_string();
+		map.path = std::move(path);
+		map.stamp = *stamp;
+		scanned.maps.push_back(std::move(map));
+	}
+
+	return scanned;
+}
+
+LoadedMap MapLoadTask::operator()(const MapLoadRequest &request) const
+{
+	LoadedMap loaded;
+	loaded.library = request.library;
+	loaded.key = request.key;
+	loaded.header.path = request.path;
+
+	auto stamp = MapCache::GetStamp(request.path);
+	if (!stamp) {
+		log::Warning("Unable to read ", request.path);
+		return loaded;
+	}
+
+	auto entry = request.cache ? request.cache->find(request.key) : std::nullopt;
+	if (entry && entry->stamp.size == stamp->size) {
+		bool current = entry->stamp.modified == stamp->modified;
+		if (!current) {
+			// touched or copied over, only the contents can tell whether it changed
+			auto hash = MapCache::HashFile(request.path);
+			current = hash && *hash == entry->stamp.hash;
+			loaded.cacheChanged = current;
+		}
+
+		if (current) {
+			if (MapCache::Read(*entry, request.path, loaded.header)) {
+				loaded.loaded = true;
+				loaded.record.path = request.key;
+				loaded.record.stamp = {stamp->size, stamp->modified, entry->stamp.hash};
+				loaded.record.header = entry->header;
+				loaded.record.owner = request.cache;
+				return loaded;
+			}
+			log::Warning("Cached copy of ", request.path, " is corrupted, reloading it");
+			loaded.header = {};
+			loaded.header.path = request.path;
+		}
+	}
+
+	loaded.loaded = LoadHeader(request.path, loaded.header);
+	if (loaded.loaded) {
+		stamp->hash = MapCache::HashFile(request.path).value_or(0);
+		loaded.record = MapCache::MakeRecord(loaded.header, request.key, *stamp);
+		loaded.cacheChanged = true;
+	} else {
+		log::Error("Failed to load map ", request.path);
+	}
+
+	return loaded;
+}
+
+RatedMap MapRatingTask::operator()(const MapRatingRequest &request) const
+{
+	RatedMap rated;
+	rated.path = request.path;
+	rated.key = request.key;
+	rated.library = request.library;
+
+	auto map = Load<MapInfo>(request.path);
+	if (map) {
+		rated.difficulty = CalculateDifficulty(*map);
+		rated.rated = true;
+	}
+
+	return rated;
+}
+
+bool MapCacheWriteTask::operator()(
+	const std::filesystem::path &cacheFile, const std::vector<MapCache::Record> &records
+) const
+{
+	return MapCache::Write(cacheFile, records);
+}
+
 int MapManager::load(const files::MultiDirectorySearch &source)
 {
-	auto filesToLoad = source.findAll("songs", Resource<MapInfo>::allowedExtensions);
+	int fileCount = 0;
+
+	for (auto searchPath = source.cbegin(); searchPath != source.cend(); searchPath++) {
+		auto songs = *searchPath / "songs";
+		if (!std::filesystem::is_directory(songs)) {
+			continue;
+		}
+
+		auto known = std::find_if(libraries.begin(), libraries.end(), [&songs](const Library &library)
+		{ return library.root == songs; });
 
-	auto fileCount = static_cast<int>(filesToLoad.size());
+		auto libraryIndex = static_cast<unsigned int>(std::distance(libraries.begin(), known));
 
-	for (auto &file : filesToLoad) {
-		results.push_back(tasks::MakeSimple(LoadTask<MapInfo>(), std::move(file)));
+		if (known == libraries.end()) {
+			Library library;
+			library.root = songs;
+			library.cacheFile = songs / MAP_CACHE_FILE;
+			auto cache = std::make_shared<MapCache>();
+			if (cache->open(library.cacheFile)) {
+				library.cachedCount = cache->size();
+				library.cache = std::move(cache);
+			}
+			libraries.push_back(std::move(library));
+			watcher.watch(songs);
+		}
+
+		fileCount += scan(libraryIndex);
 	}
 
 	return fileCount;
 }
 
+int MapManager::scan(unsigned int libraryIndex)
+{
+	auto &library = libraries[libraryIndex];
+
+	std::vector<std::filesystem::path> rootFiles;
+	std::vector<std::filesystem::path> directories;
+	if (!files::ListDirectory(library.root, GetScannedExtensions(), rootFiles, &directories)) {
+		return 0;
+	}
+
+	if (library.pendingScans == 0) {
+		library.found.clear();
+	}
+
+	int started = 0;
+	auto startScan = [&](MapScanRequest request)
+	{
+		request.root = library.root;
+		request.library = libraryIndex;
+		request.fullScan = true;
+		scans.push_back(tasks::MakeSimple({tasks::Priority::Background}, MapScanTask(), std::move(request)));
+		library.pendingScans++;
+		started++;
+	};
+
+	// maps and archives dropped straight into the songs directory
+	if (!rootFiles.empty()) {
+		MapScanRequest request;
+		request.files = std::move(rootFiles);
+		startScan(std::move(request));
+	}
+
+	for (size_t first = 0; first < directories.size(); first += MAP_SCAN_BATCH) {
+		auto last = std::min(directories.size(), first + MAP_SCAN_BATCH);
+
+		MapScanRequest request;
+		request.directories.assign(
+			std::make_move_iterator(directories.begin() + long(first)),
+			std::make_move_iterator(directories.begin() + long(last))
+		);
+		startScan(std::move(request));
+	}
+
+	if (library.pendingScans == 0) {
+		pruneLibrary(libraryIndex);
+	}
+
+	return started;
+}
+
+int MapManager::applyScan(ScannedMaps &scanned)
+{
+	auto &library = libraries[scanned.library];
+	int queued = 0;
+
+	for (auto &map : scanned.maps) {
+		// maps new to the library haven't got a record until their load finishes, they still count as found
+		if (library.pendingScans > 0) {
+			library.found.insert(map.key);
+		}
+
+		auto record = library.records.find(map.key);
+		if (record != library.records.end()) {
+			const auto &stamp = record->second.stamp;
+			if (stamp.size == map.stamp.size && stamp.modified == map.stamp.modified) {
+				continue;
+			}
+		}
+
+		enqueue(scanned.library, std::move(map.path), std::move(map.key));
+		queued++;
+	}
+
+	return queued;
+}
+
+void MapManager::pruneLibrary(unsigned int libraryIndex)
+{
+	auto &library = libraries[libraryIndex];
+
+	for (auto it = library.records.begin(); it != library.records.end();) {
+		if (library.found.contains(it->first)) {
+			it++;
+			continue;
+		}
+		removeMap(library.root / it->first);
+		it = library.records.erase(it);
+		library.dirty = true;
+	}
+
+	library.found.clear();
+}
+
+void MapManager::enqueue(unsigned int libraryIndex, std::filesystem::path path, std::string key)
+{
+	// maps the watcher picks up while a full scan runs mustn't be pruned once it finishes
+	auto &library = libraries[libraryIndex];
+	if (library.pendingScans > 0) {
+		library.found.insert(key);
+	}
+
+	MapLoadRequest request;
+	request.path = std::move(path);
+	request.key = std::move(key);
+	request.cache = library.cache;
+	request.library = libraryIndex;
+	results.push_back(tasks::MakeSimple({tasks::Priority::Background}, MapLoadTask(), std::move(request)));
+}
+
+void MapManager::applyChanges()
+{
+	bool rescan = false;
+
+	for (const auto &change : watcher.poll()) {
+		if (change.type == files::ChangeType::Overflow) {
+			rescan = true;
+			continue;
+		}
+
+		for (unsigned int i = 0; i < libraries.size(); i++) {
+			auto relative = change.path.lexically_relative(libraries[i].root);
+			if (relative.empty() || *relative.begin() == "..") {
+				continue;
+			}
+
+			auto fileName = change.path.filename().string();
+			if (change.type == files::ChangeType::Removed) {
+				removeMaps(i, change.path);
+			} else if (files::HasExtension(fileName, files::GetArchiveExtensions())) {
+				// the maps of a rewritten archive are indexed from scratch, those dropped from it have to go
+				removeMaps(i, change.path);
+				MapScanRequest request;
+				request.root = libraries[i].root;
+				request.files.push_back(change.path);
+				request.library = i;
+				scans.push_back(tasks::MakeSimple({tasks::Priority::Background}, MapScanTask(), std::move(request)));
+			} else if (files::HasExtension(fileName, Resource<MapInfo>::allowedExtensions)) {
+				enqueue(i, change.path, relative.generic_string());
+			}
+			break;
+		}
+	}
+
+	if (rescan) {
+		log::Info("Missed changes to the songs directories, rescanning them");
+		for (unsigned int i = 0; i < libraries.size(); i++) {
+			scan(i);
+		}
+	}
+}
+
+void MapManager::removeMaps(unsigned int libraryIndex, const std::filesystem::path &path)
+{
+	auto &library = libraries[libraryIndex];
+	auto key = path.lexically_relative(library.root).generic_string();
+
+	// either a single map or a whole directory of them
+	auto prefix = key + '/';
+	for (auto it = library.records.begin(); it != library.records.end();) {
+		if (it->first != key && !it->first.starts_with(prefix)) {
+			it++;
+			continue;
+		}
+		removeMap(library.root / it->first);
+		it = library.records.erase(it);
+		library.dirty = true;
+	}
+}
+
+void MapManager::removeMap(const std::filesystem::path &path)
+{
+	auto slot = slots.find(path.string());
+	if (slot == slots.end()) {
+		return;
+	}
+
+	// the last map takes the freed slot, so only two slots of the search index change
+	auto index = slot->second;
+	auto last = (uint32_t)maps.size() - 1;
+	slots.erase(slot);
+	if (index != last) {
+		maps[index] = std::move(maps.back());
+		slots[maps[index].path.string()] = index;
+		searchIndex.add(index, maps[index]);
+	}
+	searchIndex.remove(last);
+	maps.pop_back();
+}
+
+void MapManager::addMap(MapHeader map)
+{
+	auto slot = slots.find(map.path.string());
+	if (slot != slots.end()) {
+		// a map which changed, replace it where it is
+		maps[slot->second] = std::move(map);
+		searchIndex.add(slot->second, maps[slot->second]);
+		return;
+	}
+
+	auto index = (uint32_t)maps.size();
+	slots.emplace(map.path.string(), index);
+	maps.push_back(std::move(map));
+	searchIndex.add(index, maps.back());
+}
+
+void MapManager::rate(unsigned int libraryIndex, const std::filesystem::path &path, std::string key)
+{
+	MapRatingRequest request;
+	request.path = path;
+	request.key = std::move(key);
+	request.library = libraryIndex;
+	ratings.push_back(tasks::MakeSimple({tasks::Priority::Background}, MapRatingTask(), std::move(request)));
+}
+
+void MapManager::applyRating(RatedMap &rated)
+{
+	auto &library = libraries[rated.library];
+	auto record = library.records.find(rated.key);
+	auto slot = slots.find(rated.path.string());
+	if (record == library.records.end() || slot == slots.end()) {
+		// deleted while it was being rated
+		return;
+	}
+
+	// maps which can't be loaded get a rating of zero, so they aren't retried every time the library is loaded
+	auto &map = maps[slot->second];
+	map.starRating = rated.rated ? rated.difficulty.stars : 0.0f;
+	searchIndex.add(slot->second, map);
+	record->second = MapCache::MakeRecord(map, rated.key, record->second.stamp);
+	library.dirty = true;
+}
+
 int MapManager::update()
 {
-	for (const auto &task : results) {
-		if (!task.isComplete()) {
+	applyChanges();
+
+	// split off the finished tasks once, a task finishing halfway through mustn't be dropped unprocessed
+	auto finishedScans = std::stable_partition(scans.begin(), scans.end(), [](const auto &task)
+	{ return !task.isComplete(); });
+
+	for (auto task = finishedScans; task != scans.end(); task++) {
+		auto result = task->getResult();
+		if (!result) {
+			log::Warning("Scan task marked complete had incomplete result.");
 			continue;
 		}
 
-		auto result = task.getResult();
+		auto &value = result.value();
+		applyScan(value);
+		if (value.fullScan && --libraries[value.library].pendingScans == 0) {
+			pruneLibrary(value.library);
+		}
+	}
+
+	scans.erase(finishedScans, scans.end());
+
+	auto finishedLoads = std::stable_partition(results.begin(), results.end(), [](const auto &task)
+	{ return !task.isComplete(); });
+
+	for (auto task = finishedLoads; task != results.end(); task++) {
+		auto result = task->getResult();
 		if (!result) {
 			log::Warning("Load task marked complete had incomplete result.");
 			continue;
 		}
 
 		auto &value = result.value();
-		if (bool(value)) {
-			maps.push_back(std::move(value));
+		auto &library = libraries[value.library];
+		auto record = library.records.find(value.key);
+
+		if (value.loaded) {
+			if (value.header.starRating < 0.0f) {
+				rate(value.library, value.header.path, value.key);
+			}
+			addMap(std::move(value.header));
+			if (record != library.records.end()) {
+				record->second = std::move(value.record);
+			} else {
+				library.records.emplace(value.key, std::move(value.record));
+			}
+			library.dirty |= value.cacheChanged;
+		} else if (record != library.records.end()) {
+			// the map was deleted or broken since it was last loaded
+			removeMap(value.header.path);
+			library.records.erase(record);
+			library.dirty = true;
 		}
 	}
 
-	auto startingSize = (int)results.size();
+	auto finishedCount = (int)std::distance(finishedLoads, results.end());
+	results.erase(finishedLoads, results.end());
 
-	results.erase(
-		std::remove_if(results.begin(), results.end(), [](const auto &task)
-		{ return task.isComplete(); }),
-		results.end()
-	);
+	auto finishedRatings = std::stable_partition(ratings.begin(), ratings.end(), [](const auto &task)
+	{ return !task.isComplete(); });
+
+	for (auto task = finishedRatings; task != ratings.end(); task++) {
+		auto result = task->getResult();
+		if (!result) {
+			log::Warning("Rating task marked complete had incomplete result.");
+			continue;
+		}
+		applyRating(result.value());
+	}
+
+	ratings.erase(finishedRatings, ratings.end());
+
+	// ratings trickle in long after the loads, the caches are only written once they're all in
+	if (results.empty() && scans.empty() && ratings.empty()) {
+		writeCaches();
+	}
 
-	return startingSize - (int)results.size();
+	return finishedCount;
+}
+
+void MapManager::writeCaches()
+{
+	for (auto &library : libraries) {
+		// entries of maps which were deleted before they could be loaded have to go as well
+		if (!library.dirty && library.records.size() == library.cachedCount) {
+			continue;
+		}
+		// stays dirty until the write in flight is done, whatever changed meanwhile goes into the next one
+		if (!library.cacheWrite.isComplete()) {
+			continue;
+		}
+
+		std::vector<MapCache::Record> records;
+		records.reserve(library.records.size());
+		for (const auto &record : library.records) {
+			records.push_back(record.second);
+		}
+
+		library.cachedCount = records.size();
+		library.cacheWrite = tasks::MakeSimple(
+			{tasks::Priority::Background}, MapCacheWriteTask(), std::filesystem::path(library.cacheFile), std::move(records)
+		);
+		library.dirty = false;
+	}
 }
 
 bool MapManager::isLoading() const
 {
-	return !results.empty();
+	return !results.empty() || !scans.empty();
 }
 
 size_t MapManager::size() const
@@ -90,15 +572,34 @@ MapManager::MapStorageType::const_iterator MapManager::cend() const
 	return maps.cend();
 }
 
-Resource<MapInfo> MapManager::at(unsigned int i)
+const MapHeader &MapManager::at(unsigned int i) const
 {
 	return maps[i % maps.size()];
 }
 
+const MapSearchIndex &MapManager::getSearchIndex() const
+{
+	return searchIndex;
+}
+
+Resource<MapInfo> MapManager::open(unsigned int i) const
+{
+	if (maps.empty()) {
+		return nullptr;
+	}
+	return Load<MapInfo>(at(i).path);
+}
+
 void MapManager::clear()
 {
     maps.clear();
+    slots.clear();
+    searchIndex.clear();
+    scans.clear();
     results.clear();
+    ratings.clear();
+    libraries.clear();
+    watcher.clear();
 }
 
 size_t MapManager::remaining() const
@@ -106,4 +607,9 @@ size_t MapManager::remaining() const
     return results.size();
 }
 
+size_t MapManager::unrated() const
+{
+	return ratings.size();
+}
+
 }
\ No newline at end of file
@@ -24,25 +24,161 @@
 #include "define.hpp"
 
 #include "MapInfo.hpp"
+#include "DifficultyCalculator.hpp"
+#include "MapCache.hpp"
+#include "MapSearch.hpp"
 #include "Resource.hpp"
 #include "EnumOperators.hpp"
 #include "Files.hpp"
+#include "DirectoryWatcher.hpp"
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace PROJECT_NAMESPACE {
 
+/// How many map set directories a single scan task walks.
+constexpr size_t MAP_SCAN_BATCH = 32;
+
+struct MapScanRequest
+{
+	// The songs directory.
+	std::filesystem::path root;
+	std::vector<std::filesystem::path> directories;
+	// Maps and map set archives to stamp besides whatever is found in the directories.
+	std::vector<std::filesystem::path> files;
+	unsigned int library{0};
+	// Set for the batches of a scan of the whole library, which are used to find deleted maps.
+	bool fullScan{false};
+};
+
+struct ScannedMap
+{
+	std::filesystem::path path;
+	std::string key;
+	MapCache::Stamp stamp;
+};
+
+struct ScannedMaps
+{
+	std::vector<ScannedMap> maps;
+	unsigned int library{0};
+	bool fullScan{false};
+};
+
+/**
+ * Walks a batch of map set directories, including their subdirectories, and stamps every map file found in them.
+ * Map set archives (.osz) are indexed as well, every map inside one is listed with a path leading through the archive
+ * as if it was a directory.
+ */
+struct MapScanTask
+{
+	using ResultType = tasks::Result<tasks::detail::TaskHolder<ScannedMaps, MapScanTask>>;
+
+	ScannedMaps operator()(const MapScanRequest &request) const;
+};
+
+struct MapLoadRequest
+{
+	std::filesystem::path path;
+	// Path relative to the songs directory, used as the cache key.
+	std::string key;
+	std::shared_ptr<const MapCache> cache;
+	unsigned int library{0};
+};
+
+struct LoadedMap
+{
+	MapHeader header;
+	bool loaded{false};
+	std::string key;
+	// What the library's next cache file should hold for this map.
+	MapCache::Record record;
+	unsigned int library{0};
+	// Set when the record isn't an unchanged copy of the cached entry.
+	bool cacheChanged{false};
+};
+
+/**
+ * Loads the header of a single map, reading it from its library's cache when the cached copy is still current.
+ */
+struct MapLoadTask
+{
+	using ResultType = tasks::Result<tasks::detail::TaskHolder<LoadedMap, MapLoadTask>>;
+
+	LoadedMap operator()(const MapLoadRequest &request) const;
+};
+
+struct MapRatingRequest
+{
+	std::filesystem::path path;
+	std::string key;
+	unsigned int library{0};
+};
+
+struct RatedMap
+{
+	std::filesystem::path path;
+	std::string key;
+	unsigned int library{0};
+	DifficultyAttributes difficulty;
+	bool rated{false};
+};
+
+/**
+ * Loads a map along with its hit objects and calculates its difficulty. One runs for every map without a cached star
+ * rating, so they're spread over the whole pool.
+ */
+struct MapRatingTask
+{
+	using ResultType = tasks::Result<tasks::detail::TaskHolder<RatedMap, MapRatingTask>>;
+
+	RatedMap operator()(const MapRatingRequest &request) const;
+};
+
+struct MapCacheWriteTask
+{
+	using ResultType = tasks::Result<tasks::detail::TaskHolder<bool, MapCacheWriteTask>>;
+
+	bool operator()(const std::filesystem::path &cacheFile, const std::vector<MapCache::Record> &records) const;
+};
+
+/**
+ * The map library. Only map headers are kept around, the hit objects of a map are loaded once it is opened.
+ *
+ * Every songs directory is a library with its own cache. Libraries stay loaded, scanning one again only reloads the
+ * maps which changed, and while they're loaded the directories are watched so new, changed and deleted maps are picked
+ * up as they happen.
+ *
+ * Map sets are scanned in batches by background tasks, each finished batch has its maps queued for loading right away
+ * instead of waiting for the whole directory tree to be walked. Loaded maps without a star rating are then rated in the
+ * background as well and the ratings are kept in the library caches.
+ */
 class MapManager
 {
 public:
-	using MapStorageType = std::vector<Resource<MapInfo>>;
+	using MapStorageType = std::vector<MapHeader>;
 
+	/**
+	 * Adds the songs directories of every search path to the library and starts scanning them.
+	 * @return Number of scan and load tasks started, maps found by the scan tasks are queued by update().
+	 */
 	int load(const files::MultiDirectorySearch& source);
+
+	/**
+	 * Collects finished scans, loads and ratings and applies changes reported by the directory watcher.
+	 * @return Number of loads which finished.
+	 */
 	int update();
 
 	[[nodiscard]] bool isLoading() const;
 	[[nodiscard]] size_t size() const;
     [[nodiscard]] size_t remaining() const;
+	/// Number of maps still waiting for their star rating.
+	[[nodiscard]] size_t unrated() const;
 
 
     void clear();
@@ -50,11 +186,58 @@ public:
 	[[nodiscard]] MapStorageType::const_iterator cbegin() const;
 	[[nodiscard]] MapStorageType::const_iterator cend() const;
 
-	Resource<MapInfo> at(unsigned int i);
+	[[nodiscard]] const MapHeader &at(unsigned int i) const;
+
+	/// Search index over the loaded maps, the ids it returns are the indices accepted by at() and open().
+	[[nodiscard]] const MapSearchIndex &getSearchIndex() const;
+
+	/**
+	 * Loads the full map, including its hit objects.
+	 * @param i Index of the map.
+	 * @return The map or the default map if it couldn't be loaded.
+	 */
+	Resource<MapInfo> open(unsigned int i) const;
 
 private:
-	std::vector<LoadTask<MapInfo>::ResultType> results;
+	struct Library
+	{
+		// The songs directory.
+		std::filesystem::path root;
+		std::filesystem::path cacheFile;
+		std::shared_ptr<const MapCache> cache;
+		// Entries in the cache file as last written, starts off as the entries of cache.
+		size_t cachedCount{0};
+		// Every loaded map, keyed by its path relative to root.
+		std::unordered_map<std::string, MapCache::Record> records;
+		// Keys of maps seen while a full scan runs, records not among them by the time it finishes were deleted.
+		std::unordered_set<std::string> found;
+		unsigned int pendingScans{0};
+		bool dirty{false};
+		// The last write of the cache file, the next one only starts once it's done as both go through the same file.
+		MapCacheWriteTask::ResultType cacheWrite{};
+	};
+
+	int scan(unsigned int library);
+	int applyScan(ScannedMaps &scanned);
+	void pruneLibrary(unsigned int library);
+	void enqueue(unsigned int library, std::filesystem::path path, std::string key);
+	void applyChanges();
+	void removeMaps(unsigned int library, const std::filesystem::path &path);
+	void removeMap(const std::filesystem::path &path);
+	void addMap(MapHeader map);
+	void rate(unsigned int library, const std::filesystem::path &path, std::string key);
+	void applyRating(RatedMap &rated);
+	void writeCaches();
+
+	std::vector<MapScanTask::ResultType> scans;
+	std::vector<MapLoadTask::ResultType> results;
+	std::vector<MapRatingTask::ResultType> ratings;
+	std::vector<Library> libraries;
+	files::DirectoryWatcher watcher;
 	MapStorageType maps;
+	// Index of every map in maps, keyed by its path.
+	std::unordered_map<std::string, uint32_t> slots;
+	MapSearchIndex searchIndex;
 };
 
 }
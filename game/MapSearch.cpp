@@ -0,0 +1,391 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#include "MapSearch.hpp"
+
+#include "Util.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace PROJECT_NAMESPACE {
+
+namespace
+{
+
+void AppendLowercase(std::string &out, std::string_view text)
+{
+	if (text.empty()) {
+		return;
+	}
+	// fields are kept apart so no term can match across two of them
+	if (!out.empty()) {
+		out += '\n';
+	}
+	for (char c : text) {
+		out += (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+	}
+}
+
+uint32_t Gram(std::string_view text, size_t at, size_t length)
+{
+	// the length goes into the top byte so bigrams and trigrams never share a key
+	uint32_t gram = uint32_t(length) << 24;
+	for (size_t i = 0; i < length; i++) {
+		gram |= uint32_t(uint8_t(text[at + i])) << (i * 8);
+	}
+	return gram;
+}
+
+/// Bigrams and trigrams of a document.
+std::vector<uint32_t> DocumentGrams(std::string_view text)
+{
+	std::vector<uint32_t> grams;
+	if (text.size() < 2) {
+		return grams;
+	}
+	grams.reserve(text.size() * 2);
+	for (size_t i = 0; i + 1 < text.size(); i++) {
+		grams.push_back(Gram(text, i, 2));
+		if (i + 2 < text.size()) {
+			grams.push_back(Gram(text, i, 3));
+		}
+	}
+	std::sort(grams.begin(), grams.end());
+	grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+	return grams;
+}
+
+/// Grams every document containing the term has, the trigrams of longer terms already cover their bigrams.
+std::vector<uint32_t> TermGrams(std::string_view term)
+{
+	std::vector<uint32_t> grams;
+	if (term.size() == 2) {
+		grams.push_back(Gram(term, 0, 2));
+	}
+	for (size_t i = 0; i + 2 < term.size(); i++) {
+		grams.push_back(Gram(term, i, 3));
+	}
+	return grams;
+}
+
+float ApproachRate(float approachTime)
+{
+	// inverse of the conversion done by the osu! loader
+	if (approachTime >= 1.2f) {
+		return (1.8f - approachTime) / 0.12f;
+	}
+	return 5.f + (1.2f - approachTime) / 0.15f;
+}
+
+float CircleSize(float circleSize)
+{
+	return float((0.220392156862745 - circleSize * 0.5) / 0.0179411764705882);
+}
+
+}
+
+void MapSearchIndex::add(uint32_t id, const MapHeader &map)
+{
+	remove(id);
+	if (id >= documents.size()) {
+		documents.resize(id + 1);
+	}
+
+	auto &document = documents[id];
+	document.text.clear();
+	AppendLowercase(document.text, map.name);
+	AppendLowercase(document.text, map.romanisedName);
+	AppendLowercase(document.text, map.artist);
+	AppendLowercase(document.text, map.romanisedArtist);
+	AppendLowercase(document.text, map.author);
+	AppendLowercase(document.text, map.source);
+	for (const auto &tag : map.tags) {
+		AppendLowercase(document.text, tag);
+	}
+	AppendLowercase(document.text, map.difficulty);
+
+	document.approachRate = ApproachRate(map.approachTime);
+	document.circleSize = CircleSize(map.circleSize);
+	document.overallDifficulty = map.overallDifficulty;
+	document.HPDrain = map.HPDrain;
+	document.length = float(map.mapDuration);
+	document.starRating = map.starRating;
+	document.indexed = true;
+
+	for (auto gram : DocumentGrams(document.text)) {
+		auto &list = postings[gram];
+		// maps mostly arrive in slot order, which makes this an append
+		list.insert(std::upper_bound(list.begin(), list.end(), id), id);
+	}
+
+	count++;
+	version++;
+}
+
+void MapSearchIndex::remove(uint32_t id)
+{
+	if (id >= documents.size() || !documents[id].indexed) {
+		return;
+	}
+
+	auto &document = documents[id];
+	for (auto gram : DocumentGrams(document.text)) {
+		auto list = postings.find(gram);
+		if (list == postings.end()) {
+			continue;
+		}
+		auto entry = std::lower_bound(list->second.begin(), list->second.end(), id);
+		if (entry != list->second.end() && *entry == id) {
+			list->second.erase(entry);
+		}
+		if (list->second.empty()) {
+			postings.erase(list);
+		}
+	}
+
+	document = Document();
+	count--;
+	version++;
+}
+
+void MapSearchIndex::clear()
+{
+	documents.clear();
+	postings.clear();
+	count = 0;
+	version++;
+}
+
+bool MapSearchIndex::ParseFilter(std::string_view term, Filter &filter)
+{
+	auto opStart = term.find_first_of("<>=!");
+	if (opStart == std::string_view::npos || opStart == 0) {
+		return false;
+	}
+
+	auto key = term.substr(0, opStart);
+	if (key == "ar") {
+		filter.field = &Document::approachRate;
+	} else if (key == "cs") {
+		filter.field = &Document::circleSize;
+	} else if (key == "od") {
+		filter.field = &Document::overallDifficulty;
+	} else if (key == "hp") {
+		filter.field = &Document::HPDrain;
+	} else if (key == "length") {
+		filter.field = &Document::length;
+	} else if (key == "stars") {
+		filter.field = &Document::starRating;
+	} else {
+		return false;
+	}
+
+	auto opEnd = term.find_first_not_of("<>=!", opStart);
+	if (opEnd == std::string_view::npos) {
+		return false;
+	}
+	auto op = term.substr(opStart, opEnd - opStart);
+	if (op == "<") {
+		filter.op = Filter::Less;
+	} else if (op == "<=") {
+		filter.op = Filter::LessEqual;
+	} else if (op == ">") {
+		filter.op = Filter::Greater;
+	} else if (op == ">=") {
+		filter.op = Filter::GreaterEqual;
+	} else if (op == "=" || op == "==") {
+		filter.op = Filter::Equal;
+	} else if (op == "!=") {
+		filter.op = Filter::NotEqual;
+	} else {
+		return false;
+	}
+
+	filter.value = ParseNumber(term.substr(opEnd), NAN);
+	return !std::isnan(filter.value);
+}
+
+bool MapSearchIndex::Matches(const Document &document, const Filter &filter)
+{
+	auto value = document.*filter.field;
+	// levels are converted back from the stored timings, so they're only compared to a tenth
+	constexpr float EPSILON = 0.05f;
+
+	switch (filter.op) {
+		case Filter::Less:
+			return value < filter.value - EPSILON;
+		case Filter::LessEqual:
+			return value < filter.value + EPSILON;
+		case Filter::Greater:
+			return value > filter.value + EPSILON;
+		case Filter::GreaterEqual:
+			return value > filter.value - EPSILON;
+		case Filter::Equal:
+			return std::abs(value - filter.value) < EPSILON;
+		case Filter::NotEqual:
+			return std::abs(value - filter.value) >= EPSILON;
+	}
+	return false;
+}
+
+bool MapSearchIndex::Intersect(std::vector<const std::vector<uint32_t> *> lists, std::vector<uint32_t> &out)
+{
+	if (lists.empty()) {
+		return false;
+	}
+
+	// shortest first so the candidates shrink as fast as possible
+	std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b)
+	{ return a->size() != b->size() ? a->size() < b->size() : a < b; });
+	lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+	out = *lists.front();
+	std::vector<uint32_t> narrowed;
+	for (auto list = lists.begin() + 1; list != lists.end() && !out.empty(); list++) {
+		narrowed.clear();
+		if (out.size() * 16 < (*list)->size()) {
+			// few candidates left, looking each up beats walking the whole list
+			for (auto id : out) {
+				if (std::binary_search((*list)->begin(), (*list)->end(), id)) {
+					narrowed.push_back(id);
+				}
+			}
+		} else {
+			std::set_intersection(out.begin(), out.end(), (*list)->begin(), (*list)->end(), std::back_inserter(narrowed));
+		}
+		out.swap(narrowed);
+	}
+	return true;
+}
+
+bool MapSearchIndex::findGrams(std::string_view term, std::vector<const std::vector<uint32_t> *> &lists) const
+{
+	for (auto gram : TermGrams(term)) {
+		auto list = postings.find(gram);
+		if (list == postings.end()) {
+			return false;
+		}
+		lists.push_back(&list->second);
+	}
+	return true;
+}
+
+std::vector<uint32_t> MapSearchIndex::find(std::string_view query) const
+{
+	std::string lowered;
+	AppendLowercase(lowered, query);
+
+	// text terms of up to three characters are answered by the index alone, longer ones are confirmed in the text
+	std::vector<std::string_view> included, excluded;
+	std::vector<const std::vector<uint32_t> *> includedLists;
+	std::vector<Filter> filters;
+
+	std::string_view rest = lowered;
+	while (!rest.empty()) {
+		auto start = rest.find_first_not_of(" \t\n");
+		if (start == std::string_view::npos) {
+			break;
+		}
+		rest.remove_prefix(start);
+		auto term = rest.substr(0, rest.find_first_of(" \t\n"));
+		rest.remove_prefix(term.size());
+
+		Filter filter;
+		if (ParseFilter(term, filter)) {
+			filters.push_back(filter);
+		} else if (term.size() > 1 && term.front() == '-') {
+			excluded.push_back(term.substr(1));
+		} else {
+			if (!findGrams(term, includedLists)) {
+				return {};
+			}
+			if (term.size() == 1 || term.size() > 3) {
+				included.push_back(term);
+			}
+		}
+	}
+
+	std::vector<uint32_t> candidates;
+	if (!Intersect(std::move(includedLists), candidates)) {
+		candidates.reserve(count);
+		for (uint32_t id = 0; id < documents.size(); id++) {
+			if (documents[id].indexed) {
+				candidates.push_back(id);
+			}
+		}
+	}
+
+	for (auto term : included) {
+		candidates.erase(
+			std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t id)
+			{ return documents[id].text.find(term) == std::string::npos; }),
+			candidates.end()
+		);
+	}
+
+	for (auto term : excluded) {
+		std::vector<const std::vector<uint32_t> *> lists;
+		if (!findGrams(term, lists)) {
+			// nothing contains the term
+			continue;
+		}
+
+		std::vector<uint32_t> containing;
+		bool indexed = Intersect(std::move(lists), containing);
+		bool exact = indexed && term.size() <= 3;
+		candidates.erase(
+			std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t id)
+			{
+				if (indexed && !std::binary_search(containing.begin(), containing.end(), id)) {
+					return false;
+				}
+				return exact || documents[id].text.find(term) != std::string::npos;
+			}),
+			candidates.end()
+		);
+	}
+
+	if (!filters.empty()) {
+		candidates.erase(
+			std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t id)
+			{
+				return std::any_of(filters.begin(), filters.end(), [&](const Filter &filter)
+				{ return !Matches(documents[id], filter); });
+			}),
+			candidates.end()
+		);
+	}
+
+	return candidates;
+}
+
+size_t MapSearchIndex::size() const
+{
+	return count;
+}
+
+uint64_t MapSearchIndex::getVersion() const
+{
+	return version;
+}
+
+}
@@ -0,0 +1,106 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include "MapInfo.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/**
+ * Search index over the headers of the map library, used by the song select filter.
+ *
+ * The title, artist, creator, source, tags and difficulty name of every map are lowercased into a single document and
+ * every distinct bigram and trigram of it is put into an inverted index. Text terms only look at the maps listed under
+ * all of their grams, terms longer than three characters are then confirmed with a plain substring search. Maps are
+ * identified by their slot in the library, adding a map to a taken slot replaces it.
+ */
+class MapSearchIndex
+{
+public:
+	void add(uint32_t id, const MapHeader &map);
+	void remove(uint32_t id);
+	void clear();
+
+	/**
+	 * Finds the maps matching every term of the query.
+	 *
+	 * Terms are separated by whitespace and are case insensitive. A term is either text the map has to contain, text
+	 * it mustn't contain when prefixed with '-', or a numeric filter such as ar>9, cs<=4, od=8, hp!=5, stars>=6 or
+	 * length<120. Filters compare the osu! difficulty levels, length is in seconds.
+	 * @param query The search query, an empty query matches every map.
+	 * @return The ids of the matching maps in ascending order.
+	 */
+	[[nodiscard]] std::vector<uint32_t> find(std::string_view query) const;
+
+	[[nodiscard]] size_t size() const;
+
+	/// Changes whenever a map is added or removed, lets callers tell when results they kept are out of date.
+	[[nodiscard]] uint64_t getVersion() const;
+
+private:
+	struct Document
+	{
+		std::string text;
+		float approachRate{0};
+		float circleSize{0};
+		float overallDifficulty{0};
+		float HPDrain{0};
+		float length{0};
+		float starRating{0};
+		bool indexed{false};
+	};
+
+	struct Filter
+	{
+		enum Operator
+		{
+			Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual
+		};
+
+		float Document::*field{nullptr};
+		Operator op{Equal};
+		float value{0};
+	};
+
+	static bool ParseFilter(std::string_view term, Filter &filter);
+	static bool Matches(const Document &document, const Filter &filter);
+	/// Intersects sorted id lists, returns false when there are none to intersect.
+	static bool Intersect(std::vector<const std::vector<uint32_t> *> lists, std::vector<uint32_t> &out);
+	/// Collects the posting lists of every gram of the term, returns false if one of them isn't in any document.
+	bool findGrams(std::string_view term, std::vector<const std::vector<uint32_t> *> &lists) const;
+
+	std::vector<Document> documents;
+	// Bigram or trigram to the sorted ids of the documents containing it.
+	std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+	size_t count{0};
+	uint64_t version{0};
+};
+
+}
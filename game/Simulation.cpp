@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "Simulation.hpp"
+
+#include "Math.hpp"
+
+#include "nameof.hpp"
+
+#include <chrono>
+
+namespace PROJECT_NAMESPACE {
+
+SimulationResult Simulate(GameManager &game, std::unique_ptr<InputMapper> &&input, unsigned int updateRate)
+{
+    SimulationResult result;
+
+    auto map = game.getMap();
+    if (!map || updateRate == 0) {
+        return result;
+    }
+
+    double lastEnd = 0.0;
+    for (auto endTime : map->getObjectTemplates().getEndTimes()) {
+        lastEnd = math::Max(lastEnd, endTime);
+    }
+
+    game.setInputMapper(std::move(input));
+    game.reset();
+
+    double step = 1.0 / double(updateRate);
+    double begin = game.getCurrentTime();
+    auto start = std::chrono::steady_clock::now();
+
+    while (!game.isFinished() && (game.getCurrentTime() < (lastEnd + SIMULATION_TAIL))) {
+        game.update(step);
+        result.updates++;
+    }
+
+    result.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.simulatedTime = game.getCurrentTime() - begin;
+    result.score = game.getScore();
+
+    return result;
+}
+
+void WriteJudgementLog(std::ostream &out, const GameManager &game)
+{
+    auto map = game.getMap();
+    if (!map) {
+        return;
+    }
+
+    auto startTimes = map->getObjectTemplates().getStartTimes();
+    const auto &judgements = game.getJudgements();
+
+    for (size_t i = 0; i < judgements.size(); i++) {
+        out << i << '\t' << startTimes[i] << '\t';
+        if (judgements[i]) {
+            out << NAMEOF_ENUM(*judgements[i]);
+        } else {
+            out << '-';
+        }
+        out << '\n';
+    }
+}
+
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "define.hpp"
+
+#include "GameManager.hpp"
+#include "InputMapper.hpp"
+
+#include <memory>
+#include <ostream>
+
+namespace PROJECT_NAMESPACE {
+
+// How long a simulation keeps going past the end of the last object, in case an object never finishes.
+constexpr double SIMULATION_TAIL = 5.0;
+
+struct SimulationResult
+{
+    ScoreState score;
+    // Time played through, in seconds.
+    double simulatedTime = 0.0;
+    // Time the simulation took, in seconds.
+    double wallTime = 0.0;
+    size_t updates = 0;
+};
+
+/**
+ * Plays the map set on a GameManager from its start until every object is done, as fast as possible.
+ *
+ * Nothing gets drawn and no sound is played. Without a skin set on the manager hit objects also skip loading their
+ * sprites, so the run only depends on the map, the input and the update rate.
+ * @param game The game, with the map already set.
+ * @param input The input to play with, e.g. AutoPilot.
+ * @param updateRate Updates per simulated second.
+ */
+SimulationResult Simulate(GameManager &game, std::unique_ptr<InputMapper> &&input, unsigned int updateRate);
+
+/**
+ * Writes one line for every hit object of the map: its index, start time and judgement, or '-' if it hasn't been
+ * judged.
+ */
+void WriteJudgementLog(std::ostream &out, const GameManager &game);
+
+}
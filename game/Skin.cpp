@@ -23,10 +23,12 @@
 #include "Skin.hpp"
 
 #include <utility>
+#include <vector>
 
 #include "Random.hpp"
 #include "Resource.hpp"
 #include "Context.hpp"
+#include "Co.hpp"
 
 namespace PROJECT_NAMESPACE {
 
@@ -35,7 +37,7 @@ template<> const std::vector<std::string> Resource<Skin>::allowedExtensions = {"
 const std::map<std::string, std::pair<std::string, std::string>> Skin::StaticGameShaders = {};
 
 template<>
-Resource<Skin> Load(const std::filesystem::path &path)
+tasks::Co<Resource<Skin>> LoadAsync(std::filesystem::path path)
 {
     Resource<Skin> r;
 
@@ -43,8 +45,6 @@ Resource<Skin> Load(const std::filesystem::path &path)
 
     df2 settings = df2::read(path);
 
-    int failed = 0;
-
     for (const auto &entry : settings["textures"]) {
         auto &object = r->textures[entry.first];
         // apply settings
@@ -84,8 +84,34 @@ Resource<Skin> Load(const std::filesystem::path &path)
 
     log::Info("Loading skin assets...");
 
+    // Read and decode every texture side by side on the pool, the uploads are left to Load.
+    // The fallback resources get created up front so the loads don't race to create them.
+    Default<video::Image>();
+    Default<video::Texture>();
+    std::vector<tasks::Co<Resource<video::Texture>>> textureLoads;
+    textureLoads.reserve(r->textures.size());
+    for (const auto &texture : r->textures) {
+        textureLoads.push_back(LoadAsync<video::Texture>(texture.second.path));
+    }
+    auto loadedTextures = co_await tasks::All(std::move(textureLoads));
+
+    size_t textureIndex = 0;
+    for (auto &texture : r->textures) {
+        texture.second.texture = loadedTextures[textureIndex++];
+    }
+
+    co_return r;
+}
+
+template<>
+Resource<Skin> Load(const std::filesystem::path &path)
+{
+    // The calling thread sleeps through the reads, it only has to do what needs the graphics context.
+    auto r = tasks::Spawn(LoadAsync<Skin>(path), {tasks::Priority::Interactive}).blockResult();
+
+    int failed = 0;
+
     for (auto &texture : r->textures) {
-        texture.second.texture = Load<video::Texture>(texture.second.path);
         texture.second.texture->upload();
         failed += !bool(texture.second.texture && texture.second.texture->uploaded());
     }
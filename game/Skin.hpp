@@ -42,6 +42,7 @@ constexpr time::FPS DEFAULT_TEXTURE_FPS = 60;
 class Skin
 {
     friend Resource<Skin> Load<Skin>(const std::filesystem::path &path);
+    friend tasks::Co<Resource<Skin>> LoadAsync<Skin>(std::filesystem::path path);
 public:
     enum class ColourAssignmentMode: uint8_t
     {
@@ -99,6 +100,9 @@ private:
 template<>
 Resource<Skin> Load(const std::filesystem::path &path);
 
+template<>
+tasks::Co<Resource<Skin>> LoadAsync(std::filesystem::path path);
+
 template<> const std::vector<std::string> Resource<Skin>::allowedExtensions;
 
 }
\ No newline at end of file
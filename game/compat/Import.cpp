@@ -1,6 +1,7 @@
 #include "Import.hpp"
 
 #include "Context.hpp"
+#include "ZipArchive.hpp"
 
 #include <array>
 
@@ -46,7 +47,9 @@ std::vector<OsuInstallation> FindOsuInstallations()
         install.skinCount = install.songCount = 0;
 
         for (const auto &file : std::filesystem::directory_iterator(path / "Songs")) {
-            if (file.is_directory()) {
+            // sets which haven't been unpacked by osu! yet are loaded straight out of their archives
+            auto fileName = file.path().filename().string();
+            if (file.is_directory() || files::HasExtension(fileName, files::GetArchiveExtensions())) {
                 install.songCount++;
             }
         }
@@ -86,15 +89,39 @@ bool ImportOsuData(const std::filesystem::path &path)
     bool allGood = true;
 
     std::error_code ec;
-    std::filesystem::copy(
-        songPath, localSongPath,
-        std::filesystem::copy_options::skip_existing |
-            std::filesystem::copy_options::recursive,
-        ec
-    );
-    if (!ec) {
+    std::filesystem::create_directories(localSongPath, ec);
+    if (ec) {
+        log::Error("Failed to create ", localSongPath, ": ", ec.message());
+        return false;
+    }
+
+    // every set ends up as a single archive, the library reads maps straight out of those
+    for (const auto &set : std::filesystem::directory_iterator(songPath, ec)) {
+        auto fileName = set.path().filename();
+
+        if (set.is_directory()) {
+            auto archive = localSongPath / fileName;
+            archive += ".osz";
+            if (std::filesystem::exists(archive)) {
+                continue;
+            }
+            if (!files::WriteArchive(set.path(), archive)) {
+                allGood = false;
+                log::Error("Failed to pack song ", set.path());
+            }
+        } else if (files::HasExtension(fileName.string(), files::GetArchiveExtensions())) {
+            std::error_code copyError;
+            std::filesystem::copy_file(
+                set.path(), localSongPath / fileName, std::filesystem::copy_options::skip_existing, copyError);
+            if (copyError) {
+                allGood = false;
+                log::Error("Failed to copy song ", set.path(), ": ", copyError.message());
+            }
+        }
+    }
+    if (ec) {
         allGood = false;
-        log::Error("Failed to copy song: ", ec.message());
+        log::Error("Failed to list songs in ", songPath, ": ", ec.message());
     }
 
     auto skinPath = path / "Skins";
@@ -53,7 +53,7 @@ void AutoPilot::update(const GameManager& game)
 	if (next == objects.end())
 		return;
 
-	const auto& thisPtr = *next;
+	const auto* thisPtr = *next;
 
 	target = thisPtr->getSOF().position;
 	held = game.getCurrentTime() >= thisPtr->getStartTime();
@@ -61,12 +61,12 @@ void AutoPilot::update(const GameManager& game)
 	auto direction = target - position;
 	auto normalized = math::Normalize(direction);
 
-	auto currentObjectStart = next->get()->getStartTime();
+	auto currentObjectStart = thisPtr->getStartTime();
 	fvec2d nextObjectPosition = {0.0f, 0.0f};
 	auto previousObjectEnd = currentObjectStart - 1.0;
 	BaseHitObject *from;
 	if (next != objects.begin()) {
-		from = std::prev(next)->get();
+		from = *std::prev(next);
 		previousObjectEnd = from->getEndTime();
 		nextObjectPosition = from->getSOF().position;
 	}
@@ -24,7 +24,7 @@
 #include "define.hpp"
 
 #include "InputMapper.hpp"
-#include "Context.hpp"
+#include "Setting.hpp"
 
 namespace PROJECT_NAMESPACE {
 
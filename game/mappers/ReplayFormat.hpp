@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+#pragma once
+
+#include "define.hpp"
+
+#include "EnumOperators.hpp"
+#include "InputMapper.hpp"
+#include "Vector.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/*
+ * Replays are a header followed by one frame for every time the recorded input changed course:
+ *   header: REPLAY_MAGIC, REPLAY_VERSION
+ *   frame:  varint (time - time of the previous frame) << 2 | REPLAY_FRAME_KEYS | REPLAY_FRAME_MOVED, in time steps
+ *           byte   ReplayKeys, if REPLAY_FRAME_KEYS is set
+ *           varint zigzag(x - predicted x), varint zigzag(y - predicted y), in position steps, if REPLAY_FRAME_MOVED
+ *                  is set
+ * Between frames the cursor is predicted to follow the parabola through the last three frames that moved it, the
+ * recorder only writes a frame once the input strays from that prediction or the keys change.
+ */
+
+constexpr std::array<uint8_t, 4> REPLAY_MAGIC{'O', 'P', 'R', 'P'};
+
+constexpr uint8_t REPLAY_VERSION = 2;
+
+// Times are stored in steps of 1/REPLAY_TIME_SCALE of a second, updates closer together than that share a frame. Only
+// simulations running faster than that many updates a second play back differently from how they were recorded.
+constexpr int64_t REPLAY_TIME_SCALE = 1000;
+
+// Cursor positions are stored in steps of 1/REPLAY_POSITION_SCALE of a play field unit.
+constexpr int REPLAY_POSITION_SCALE = 1024;
+
+// Cursor positions are clamped to this many steps, far outside of the play field.
+constexpr int REPLAY_POSITION_LIMIT = 1 << 24;
+
+// How far the cursor may stray from the predicted path before a frame gets recorded, in position steps. About one and
+// a half osu! pixels, the play field being two units tall.
+constexpr int REPLAY_TOLERANCE = 8;
+
+// Flags in the low bits of a frame's time.
+constexpr uint64_t REPLAY_FRAME_KEYS = 1 << 0;
+constexpr uint64_t REPLAY_FRAME_MOVED = 1 << 1;
+
+// How long the curve of the cursor's path keeps bending the prediction, in time steps. Past that the prediction carries
+// on in a straight line, extrapolating the curve any further overshoots more often than it helps.
+constexpr int64_t REPLAY_CURVE_HORIZON = 5;
+
+// Frames further apart than this, in time steps, are too old to tell the curve of the path, the cursor is predicted to
+// move in a straight line through the last two instead. Also keeps the integer math below from overflowing.
+constexpr int64_t REPLAY_CURVE_SPAN = 100;
+
+// How far ahead the cursor is extrapolated at most, in time steps, it stays put after that.
+constexpr int64_t REPLAY_PREDICTION_LIMIT = 1000;
+
+// Frames between two seek points of a replay being played back.
+constexpr size_t REPLAY_SEEK_INTERVAL = 256;
+
+/// Answers of the key queries of an InputMapper, one bit each.
+enum class ReplayKeys : uint8_t
+{
+	NONE = 0,
+	PRESSED = 1 << 0,
+	PRESSED_NO_BLOCKING = 1 << 1,
+	PRESSING = 1 << 2,
+	PRESSING_NO_BLOCKING = 1 << 3,
+	RELEASED = 1 << 4,
+};
+
+ENABLE_BITMASK_OPERATORS(ReplayKeys)
+
+/**
+ * What a replay has said so far: the last three frames that moved the cursor, which it is extrapolated from until the
+ * next one, and the last keys.
+ * Integer math only, so playback predicts exactly what the recorder did.
+ */
+struct ReplayState
+{
+	int64_t time{0};
+	// oldest first
+	std::array<int64_t, 3> cursorTimes{};
+	std::array<ivec2d, 3> cursorPositions{};
+	size_t moves{0};
+	ReplayKeys keys{ReplayKeys::RELEASED};
+	size_t frames{0};
+
+	[[nodiscard]] ivec2d predict(int64_t at) const
+	{
+		if (moves == 0) {
+			return {0, 0};
+		}
+
+		const auto &position = cursorPositions[2];
+		int64_t span = cursorTimes[2] - cursorTimes[1];
+		if (moves < 2 || span <= 0) {
+			return position;
+		}
+
+		int64_t previousSpan = cursorTimes[1] - cursorTimes[0];
+		bool curved = (moves >= 3) && (previousSpan > 0) && (span <= REPLAY_CURVE_SPAN) &&
+			(previousSpan <= REPLAY_CURVE_SPAN);
+		int64_t ahead = std::clamp<int64_t>(at - cursorTimes[2], 0, REPLAY_PREDICTION_LIMIT);
+
+		ivec2d predicted;
+		for (size_t i = 0; i < 2; i++) {
+			int64_t distance = int64_t(position[i]) - cursorPositions[1][i];
+			int64_t value;
+			if (curved) {
+				// the parabola through the three frames is position + velocity * ahead + bend * ahead^2, with velocity
+				// and bend sharing the denominator below
+				int64_t previousDistance = int64_t(cursorPositions[1][i]) - cursorPositions[0][i];
+				int64_t denominator = span * previousSpan * (span + previousSpan);
+				int64_t bend = distance * previousSpan - previousDistance * span;
+				int64_t velocity = distance * previousSpan * (span + previousSpan) + bend * span;
+				int64_t bent = std::min(ahead, REPLAY_CURVE_HORIZON);
+				value = position[i] + (velocity * ahead + bend * bent * ahead) / denominator;
+			} else {
+				value = position[i] + distance * ahead / span;
+			}
+			predicted[i] = int(std::clamp<int64_t>(value, -REPLAY_POSITION_LIMIT, REPLAY_POSITION_LIMIT));
+		}
+		return predicted;
+	}
+
+	void move(int64_t at, const ivec2d &to)
+	{
+		std::rotate(cursorTimes.begin(), cursorTimes.begin() + 1, cursorTimes.end());
+		std::rotate(cursorPositions.begin(), cursorPositions.begin() + 1, cursorPositions.end());
+		cursorTimes[2] = at;
+		cursorPositions[2] = to;
+		moves++;
+	}
+};
+
+inline int64_t ToReplayTime(double seconds)
+{
+	return std::llround(seconds * double(REPLAY_TIME_SCALE));
+}
+
+inline double FromReplayTime(int64_t steps)
+{
+	return double(steps) / double(REPLAY_TIME_SCALE);
+}
+
+inline ivec2d ToReplayPosition(const fvec2d &position)
+{
+	ivec2d steps;
+	for (size_t i = 0; i < 2; i++) {
+		double value = std::round(double(position[i]) * REPLAY_POSITION_SCALE);
+		steps[i] = int(std::clamp<double>(value, -REPLAY_POSITION_LIMIT, REPLAY_POSITION_LIMIT));
+	}
+	return steps;
+}
+
+inline fvec2d FromReplayPosition(const ivec2d &steps)
+{
+	return {float(steps[0]) / REPLAY_POSITION_SCALE, float(steps[1]) / REPLAY_POSITION_SCALE};
+}
+
+inline ReplayKeys ReadReplayKeys(const InputMapper &input)
+{
+	auto keys = ReplayKeys::NONE;
+	if (input.isKeyPressed(InputMapper::BLOCKING)) {
+		keys |= ReplayKeys::PRESSED;
+	}
+	if (input.isKeyPressed(InputMapper::NO_BLOCKING)) {
+		keys |= ReplayKeys::PRESSED_NO_BLOCKING;
+	}
+	if (input.isKeyPressing(InputMapper::BLOCKING)) {
+		keys |= ReplayKeys::PRESSING;
+	}
+	if (input.isKeyPressing(InputMapper::NO_BLOCKING)) {
+		keys |= ReplayKeys::PRESSING_NO_BLOCKING;
+	}
+	if (input.isKeyReleased()) {
+		keys |= ReplayKeys::RELEASED;
+	}
+	return keys;
+}
+
+inline void WriteVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+inline bool ReadVarint(const uint8_t *&it, const uint8_t *end, uint64_t &value)
+{
+	value = 0;
+	for (unsigned int shift = 0; (it != end) && (shift < 64); shift += 7) {
+		uint8_t byte = *it++;
+		value |= uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline uint64_t ZigZag(int64_t value)
+{
+	return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+inline int64_t UnZigZag(uint64_t value)
+{
+	return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+/// Appends a frame to a replay and advances the state past it, moving the cursor only if moved is set.
+inline void WriteReplayFrame(std::vector<uint8_t> &out, ReplayState &state, int64_t time, bool moved,
+							 const ivec2d &position, ReplayKeys keys)
+{
+	auto predicted = state.predict(time);
+
+	uint64_t flags = (keys != state.keys ? REPLAY_FRAME_KEYS : 0) | (moved ? REPLAY_FRAME_MOVED : 0);
+	WriteVarint(out, (uint64_t(time - state.time) << 2) | flags);
+	if (flags & REPLAY_FRAME_KEYS) {
+		out.push_back(uint8_t(keys));
+		state.keys = keys;
+	}
+	if (flags & REPLAY_FRAME_MOVED) {
+		WriteVarint(out, ZigZag(int64_t(position[0]) - predicted[0]));
+		WriteVarint(out, ZigZag(int64_t(position[1]) - predicted[1]));
+		state.move(time, position);
+	}
+	state.time = time;
+	state.frames++;
+}
+
+/// Reads the next frame of a replay into the state, false if the data ends or is cut off.
+inline bool ReadReplayFrame(const uint8_t *&it, const uint8_t *end, ReplayState &state)
+{
+	uint64_t header, x = 0, y = 0;
+	// a gap of more than a few weeks can only come from a broken file
+	if (!ReadVarint(it, end, header) || ((header >> 2) > uint64_t(INT32_MAX))) {
+		return false;
+	}
+
+	auto keys = state.keys;
+	if (header & REPLAY_FRAME_KEYS) {
+		if (it == end) {
+			return false;
+		}
+		keys = ReplayKeys(*it++);
+	}
+	if ((header & REPLAY_FRAME_MOVED) && (!ReadVarint(it, end, x) || !ReadVarint(it, end, y))) {
+		return false;
+	}
+
+	int64_t time = state.time + int64_t(header >> 2);
+	if (header & REPLAY_FRAME_MOVED) {
+		auto predicted = state.predict(time);
+		auto offset = [](uint64_t value)
+		{
+			return std::clamp<int64_t>(UnZigZag(value), -2 * REPLAY_POSITION_LIMIT, 2 * REPLAY_POSITION_LIMIT);
+		};
+		state.move(time, {
+			int(std::clamp<int64_t>(predicted[0] + offset(x), -REPLAY_POSITION_LIMIT, REPLAY_POSITION_LIMIT)),
+			int(std::clamp<int64_t>(predicted[1] + offset(y), -REPLAY_POSITION_LIMIT, REPLAY_POSITION_LIMIT))
+		});
+	}
+	state.time = time;
+	state.keys = keys;
+	state.frames++;
+	return true;
+}
+
+}
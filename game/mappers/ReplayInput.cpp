@@ -0,0 +1,161 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+#include "ReplayInput.hpp"
+
+#include "GameManager.hpp"
+#include "Log.hpp"
+
+#include <fstream>
+#include <iterator>
+
+namespace PROJECT_NAMESPACE {
+
+constexpr size_t REPLAY_HEADER_SIZE = REPLAY_MAGIC.size() + 1;
+
+ReplayInput::ReplayInput(std::vector<uint8_t> &&dataIn) :
+	data(std::move(dataIn)), offset(REPLAY_HEADER_SIZE), cursor{0.0f, 0.0f}
+{
+	if (data.size() < REPLAY_HEADER_SIZE || !std::equal(REPLAY_MAGIC.begin(), REPLAY_MAGIC.end(), data.begin())) {
+		log::Error("Not a replay");
+		return;
+	}
+
+	if (data[REPLAY_MAGIC.size()] != REPLAY_VERSION) {
+		log::Error("Unsupported replay version ", int(data[REPLAY_MAGIC.size()]));
+		return;
+	}
+
+	const uint8_t *begin = data.data();
+	const uint8_t *end = begin + data.size();
+	const uint8_t *it = begin + REPLAY_HEADER_SIZE;
+
+	ReplayState scan;
+	while (it != end) {
+		auto frame = it;
+		auto before = scan;
+		if (!ReadReplayFrame(it, end, scan)) {
+			log::Warning("Replay is cut off after ", scan.frames, " frames");
+			data.resize(frame - begin);
+			break;
+		}
+		if (before.frames % REPLAY_SEEK_INTERVAL == 0) {
+			seekPoints.push_back({size_t(frame - begin), before, scan.time});
+		}
+	}
+
+	length = scan.time;
+	valid = true;
+}
+
+bool ReplayInput::isKeyPressed(InputMapper::BlockMode mode) const
+{
+	return bool(state.keys & (mode == BLOCKING ? ReplayKeys::PRESSED : ReplayKeys::PRESSED_NO_BLOCKING));
+}
+
+bool ReplayInput::isKeyReleased() const
+{
+	return bool(state.keys & ReplayKeys::RELEASED);
+}
+
+bool ReplayInput::isKeyPressing(InputMapper::BlockMode mode) const
+{
+	return bool(state.keys & (mode == BLOCKING ? ReplayKeys::PRESSING : ReplayKeys::PRESSING_NO_BLOCKING));
+}
+
+fvec2d ReplayInput::getCursor() const
+{
+	return cursor;
+}
+
+void ReplayInput::update(const GameManager &game)
+{
+	seek(game.getCurrentTime());
+}
+
+void ReplayInput::seek(double seconds)
+{
+	if (!valid) {
+		return;
+	}
+
+	auto time = ToReplayTime(seconds);
+
+	// jump to the closest seek point when going back or when it saves decoding frames going forward
+	auto point = std::upper_bound(seekPoints.begin(), seekPoints.end(), time, [](int64_t t, const SeekPoint &p) {
+		return t < p.time;
+	});
+	if (point == seekPoints.begin()) {
+		offset = REPLAY_HEADER_SIZE;
+		state = ReplayState();
+	} else {
+		point = std::prev(point);
+		if (time < state.time || point->offset > offset) {
+			offset = point->offset;
+			state = point->state;
+		}
+	}
+
+	const uint8_t *begin = data.data();
+	const uint8_t *end = begin + data.size();
+	const uint8_t *it = begin + offset;
+
+	while (it != end) {
+		auto next = it;
+		auto peek = state;
+		if (!ReadReplayFrame(next, end, peek) || peek.time > time) {
+			break;
+		}
+		it = next;
+		state = peek;
+	}
+
+	offset = it - begin;
+	cursor = FromReplayPosition(state.predict(time));
+}
+
+bool ReplayInput::isValid() const
+{
+	return valid;
+}
+
+double ReplayInput::getLength() const
+{
+	return FromReplayTime(length);
+}
+
+std::unique_ptr<ReplayInput> LoadReplay(const std::filesystem::path &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		log::Error("Failed to open replay ", path);
+		return nullptr;
+	}
+
+	std::vector<uint8_t> data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+	auto replay = std::make_unique<ReplayInput>(std::move(data));
+	if (!replay->isValid()) {
+		return nullptr;
+	}
+	return replay;
+}
+
+}
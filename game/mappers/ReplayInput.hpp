@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+#pragma once
+
+#include "define.hpp"
+
+#include "InputMapper.hpp"
+#include "ReplayFormat.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/**
+ * Plays back a replay written by ReplayRecorder.
+ *
+ * The replay is decoded once up front to place a seek point every REPLAY_SEEK_INTERVAL frames, so jumping around in
+ * the map only ever decodes a few hundred frames.
+ */
+class ReplayInput : public InputMapper
+{
+public:
+	explicit ReplayInput(std::vector<uint8_t> &&data);
+
+	[[nodiscard]] bool isKeyPressed(BlockMode mode) const override;
+	[[nodiscard]] bool isKeyReleased() const override;
+	[[nodiscard]] bool isKeyPressing(BlockMode mode) const override;
+	[[nodiscard]] fvec2d getCursor() const override;
+	void update(const GameManager&) override;
+
+	/// Moves the playback to a point in time, in seconds.
+	void seek(double time);
+
+	[[nodiscard]] bool isValid() const;
+
+	[[nodiscard]] double getLength() const;
+
+private:
+	struct SeekPoint
+	{
+		size_t offset;
+		ReplayState state;
+		int64_t time;
+	};
+
+	std::vector<uint8_t> data;
+	std::vector<SeekPoint> seekPoints;
+	size_t offset{0};
+	ReplayState state;
+	int64_t length{0};
+	bool valid{false};
+	fvec2d cursor;
+};
+
+std::unique_ptr<ReplayInput> LoadReplay(const std::filesystem::path &path);
+
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+#include "ReplayRecorder.hpp"
+
+#include "GameManager.hpp"
+#include "Log.hpp"
+
+#include <fstream>
+
+namespace PROJECT_NAMESPACE {
+
+ReplayRecorder::ReplayRecorder(std::unique_ptr<InputMapper> &&inputIn) :
+	input(std::move(inputIn)), data(REPLAY_MAGIC.begin(), REPLAY_MAGIC.end()), cursor{0.0f, 0.0f}
+{
+	data.push_back(REPLAY_VERSION);
+}
+
+bool ReplayRecorder::isKeyPressed(InputMapper::BlockMode mode) const
+{
+	return bool(state.keys & (mode == BLOCKING ? ReplayKeys::PRESSED : ReplayKeys::PRESSED_NO_BLOCKING));
+}
+
+bool ReplayRecorder::isKeyReleased() const
+{
+	return bool(state.keys & ReplayKeys::RELEASED);
+}
+
+bool ReplayRecorder::isKeyPressing(InputMapper::BlockMode mode) const
+{
+	return bool(state.keys & (mode == BLOCKING ? ReplayKeys::PRESSING : ReplayKeys::PRESSING_NO_BLOCKING));
+}
+
+fvec2d ReplayRecorder::getCursor() const
+{
+	return cursor;
+}
+
+void ReplayRecorder::update(const GameManager &game)
+{
+	input->update(game);
+
+	// frames never go back in time, playback only ever reads forward from a seek point
+	auto time = std::max(ToReplayTime(game.getCurrentTime()), state.time);
+	auto keys = ReadReplayKeys(*input);
+	auto position = ToReplayPosition(input->getCursor());
+	auto predicted = state.predict(time);
+
+	// only write a frame once the input can't be predicted from the previous ones anymore
+	bool strayed =
+		(std::abs(position[0] - predicted[0]) > REPLAY_TOLERANCE) ||
+		(std::abs(position[1] - predicted[1]) > REPLAY_TOLERANCE);
+
+	if (strayed || (keys != state.keys)) {
+		WriteReplayFrame(data, state, time, strayed, position, keys);
+	}
+
+	cursor = FromReplayPosition(state.predict(time));
+}
+
+const std::vector<uint8_t> &ReplayRecorder::getData() const
+{
+	return data;
+}
+
+bool ReplayRecorder::save(const std::filesystem::path &path) const
+{
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char *>(data.data()), std::streamsize(data.size()));
+	if (!out) {
+		log::Error("Failed to write replay ", path);
+		return false;
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+#pragma once
+
+#include "define.hpp"
+
+#include "InputMapper.hpp"
+#include "ReplayFormat.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/**
+ * Records the input of another mapper while passing it on to the game.
+ *
+ * The game sees the cursor the way it will be played back, predicted from the recorded frames, so a replay of the
+ * recording plays out exactly the same.
+ */
+class ReplayRecorder : public InputMapper
+{
+public:
+	explicit ReplayRecorder(std::unique_ptr<InputMapper> &&input);
+
+	[[nodiscard]] bool isKeyPressed(BlockMode mode) const override;
+	[[nodiscard]] bool isKeyReleased() const override;
+	[[nodiscard]] bool isKeyPressing(BlockMode mode) const override;
+	[[nodiscard]] fvec2d getCursor() const override;
+	void update(const GameManager&) override;
+
+	/// The replay recorded so far.
+	[[nodiscard]] const std::vector<uint8_t> &getData() const;
+
+	bool save(const std::filesystem::path &path) const;
+
+private:
+	std::unique_ptr<InputMapper> input;
+	std::vector<uint8_t> data;
+	ReplayState state;
+	fvec2d cursor;
+};
+
+}
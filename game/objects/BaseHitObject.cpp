@@ -25,7 +25,6 @@
 #include "GameManager.hpp"
 #include "Math.hpp"
 #include "Util.hpp"
-#include "Context.hpp"
 
 namespace PROJECT_NAMESPACE
 {
@@ -263,12 +262,14 @@ void BaseHitObject::press()
     }
 }
 
+#ifndef HEADLESS
 void BaseHitObject::draw(video::LambdaRender &gfx)
 {
     if (getState() != HitObjectState::INVISIBLE) {
         this->onDraw(gfx);
     }
 }
+#endif
 
 float BaseHitObject::getAlpha() const
 {
@@ -300,6 +301,12 @@ const GameManager &BaseHitObject::getGame() const
     return *game;
 }
 
+void BaseHitObject::prepare()
+{
+    onPrepare();
+}
+
+#ifndef HEADLESS
 void BaseHitObject::create(Resource<Skin> &skin)
 {
     onCreate(skin);
@@ -309,6 +316,9 @@ void BaseHitObject::onDraw(video::LambdaRender &)
 {}
 void BaseHitObject::onCreate(Resource<Skin> &)
 {}
+#endif
+void BaseHitObject::onPrepare()
+{}
 void BaseHitObject::onLogicUpdate()
 {}
 void BaseHitObject::onBegin()
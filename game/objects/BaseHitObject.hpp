@@ -26,7 +26,10 @@
 
 #include "Circle.hpp"
 #include "Enum.hpp"
+
+#ifndef HEADLESS
 #include "Context.hpp"
+#endif
 
 namespace PROJECT_NAMESPACE {
 
@@ -62,7 +65,13 @@ class BaseHitObject
 {
     friend class GameManager;
 public:
+    // Skin independent setup, doesn't touch the skin or the renderer so it may run on a pool thread.
+    // Called before create().
+    void prepare();
+
+#ifndef HEADLESS
     void create(Resource<Skin>&);
+#endif
 
     void update();
 
@@ -72,7 +81,9 @@ public:
 
     void raise();
 
+#ifndef HEADLESS
     void draw(video::LambdaRender&);
+#endif
 
 	[[nodiscard]] HitResult finish();
 
@@ -135,7 +146,9 @@ protected:
 
     [[nodiscard]] float getAlpha() const;
 
+#ifndef HEADLESS
     virtual void onDraw(video::LambdaRender& gfx);
+#endif
 
     virtual void onUpdate();
 
@@ -149,7 +162,11 @@ protected:
 
     virtual void onReset();
 
+    virtual void onPrepare();
+
+#ifndef HEADLESS
     virtual void onCreate(Resource<Skin>&);
+#endif
 
     [[nodiscard]] virtual HitResult onFinish();
 
@@ -31,7 +31,6 @@
 #include "Math.hpp"
 #include "Util.hpp"
 #include "Vector.hpp"
-#include "Context.hpp"
 
 #include <memory>
 #include <string>
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "ObjectTemplateStore.hpp"
+
+#include <algorithm>
+
+namespace PROJECT_NAMESPACE {
+
+size_t ObjectTemplateStore::insert(double time)
+{
+    auto index = size_t(std::upper_bound(startTimes.begin(), startTimes.end(), time) - startTimes.begin());
+    auto at = [index](auto &column)
+    { return column.begin() + long(index); };
+
+    startTimes.insert(at(startTimes), time);
+    endTimes.insert(at(endTimes), time);
+    types.insert(at(types), HitObjectType::None);
+    parameters.insert(at(parameters), HitObjectParams::NONE);
+    positions.insert(at(positions), fvec2d{0.f, 0.f});
+    details.insert(at(details), 0);
+    return index;
+}
+
+void ObjectTemplateStore::addNote(const fvec2d &position, HitObjectParams params, double time)
+{
+    auto i = insert(time);
+    types[i] = HitObjectType::Note;
+    parameters[i] = params;
+    positions[i] = position;
+}
+
+void ObjectTemplateStore::addSlider(
+    const SliderPathT &path, HitObjectParams params, double time, double endTime, math::CurveType type,
+    unsigned int repeats
+)
+{
+    auto i = insert(time);
+    types[i] = HitObjectType::Slider;
+    parameters[i] = params;
+    endTimes[i] = endTime;
+    positions[i] = path.empty() ? fvec2d{0.f, 0.f} : path.front().position;
+    details[i] = uint32_t(sliders.size());
+
+    SliderDetails slider;
+    slider.pathBegin = uint32_t(points.size());
+    slider.pathSize = uint32_t(path.size());
+    slider.repeats = repeats;
+    slider.curveType = type;
+    sliders.push_back(slider);
+
+    for (const auto &node : path) {
+        points.push_back(node.position);
+    }
+}
+
+void ObjectTemplateStore::addSpinner(
+    float spinRequired, float spinResistance, double time, double endTime, const fvec2d &position, bool free
+)
+{
+    auto i = insert(time);
+    types[i] = HitObjectType::Spinner;
+    endTimes[i] = endTime;
+    positions[i] = position;
+    details[i] = uint32_t(spinners.size());
+    spinners.push_back({spinRequired, spinResistance, free});
+}
+
+void ObjectTemplateStore::clear()
+{
+    startTimes.clear();
+    endTimes.clear();
+    types.clear();
+    parameters.clear();
+    positions.clear();
+    details.clear();
+    sliders.clear();
+    spinners.clear();
+    points.clear();
+}
+
+void ObjectTemplateStore::shrinkToFit()
+{
+    startTimes.shrink_to_fit();
+    endTimes.shrink_to_fit();
+    types.shrink_to_fit();
+    parameters.shrink_to_fit();
+    positions.shrink_to_fit();
+    details.shrink_to_fit();
+    sliders.shrink_to_fit();
+    spinners.shrink_to_fit();
+    points.shrink_to_fit();
+}
+
+size_t ObjectTemplateStore::size() const
+{
+    return startTimes.size();
+}
+
+bool ObjectTemplateStore::empty() const
+{
+    return startTimes.empty();
+}
+
+std::span<const double> ObjectTemplateStore::getStartTimes() const
+{
+    return startTimes;
+}
+
+std::span<const double> ObjectTemplateStore::getEndTimes() const
+{
+    return endTimes;
+}
+
+std::span<const HitObjectType> ObjectTemplateStore::getTypes() const
+{
+    return types;
+}
+
+std::span<const HitObjectParams> ObjectTemplateStore::getParameters() const
+{
+    return parameters;
+}
+
+std::span<const fvec2d> ObjectTemplateStore::getPositions() const
+{
+    return positions;
+}
+
+const ObjectTemplateStore::SliderDetails &ObjectTemplateStore::getSlider(size_t i) const
+{
+    return sliders[details[i]];
+}
+
+std::span<const fvec2d> ObjectTemplateStore::getPath(size_t i) const
+{
+    const auto &slider = getSlider(i);
+    return std::span<const fvec2d>(points).subspan(slider.pathBegin, slider.pathSize);
+}
+
+const ObjectTemplateStore::SpinnerDetails &ObjectTemplateStore::getSpinner(size_t i) const
+{
+    return spinners[details[i]];
+}
+
+std::shared_ptr<ObjectTemplateNote> ObjectTemplateStore::makeNote(size_t i) const
+{
+    auto object = std::make_shared<ObjectTemplateNote>();
+    object->startTime = startTimes[i];
+    object->endTime = endTimes[i];
+    object->parameters = parameters[i];
+    object->position = positions[i];
+    return object;
+}
+
+std::shared_ptr<ObjectTemplateSlider> ObjectTemplateStore::makeSlider(size_t i) const
+{
+    auto object = std::make_shared<ObjectTemplateSlider>();
+    object->startTime = startTimes[i];
+    object->endTime = endTimes[i];
+    object->parameters = parameters[i];
+
+    const auto &slider = getSlider(i);
+    object->sliderType = slider.curveType;
+    object->repeats = slider.repeats;
+    for (const auto &point : getPath(i)) {
+        object->path.emplace_back(point, false);
+    }
+    return object;
+}
+
+std::shared_ptr<ObjectTemplateSpinner> ObjectTemplateStore::makeSpinner(size_t i) const
+{
+    auto object = std::make_shared<ObjectTemplateSpinner>();
+    object->startTime = startTimes[i];
+    object->endTime = endTimes[i];
+    object->parameters = parameters[i];
+    object->position = positions[i];
+
+    const auto &spinner = getSpinner(i);
+    object->spinRequired = spinner.spinRequired;
+    object->spinResistance = spinner.spinResistance;
+    object->free = spinner.free;
+    return object;
+}
+
+size_t ObjectTemplateStore::getMemoryUsage() const
+{
+    auto bytes = [](const auto &column)
+    { return column.capacity() * sizeof(column[0]); };
+
+    return bytes(startTimes) + bytes(endTimes) + bytes(types) + bytes(parameters) + bytes(positions) +
+        bytes(details) + bytes(sliders) + bytes(spinners) + bytes(points);
+}
+
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "define.hpp"
+
+#include "ObjectTemplates.hpp"
+#include "Vector.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/**
+ * The hit object templates of a map, kept column by column in time order.
+ *
+ * Every object has its times, type, parameters and position stored in contiguous arrays, so whatever walks the whole
+ * map only touches the columns it needs. Slider and spinner specific values live in side tables the details column
+ * points into and the control points of every slider share one buffer.
+ *
+ * Hit objects still work with the template structs, which are only built for an object once it's instantiated.
+ */
+class ObjectTemplateStore
+{
+public:
+    struct SliderDetails
+    {
+        // Range of the slider's control points in the point buffer, the first one is the slider's head.
+        uint32_t pathBegin = 0;
+        uint32_t pathSize = 0;
+        unsigned int repeats = 1;
+        math::CurveType curveType = math::CurveType::STRAIGHT;
+    };
+
+    struct SpinnerDetails
+    {
+        float spinRequired = 1.f;
+        float spinResistance = 0.f;
+        bool free = false;
+    };
+
+    void addNote(const fvec2d &position, HitObjectParams parameters, double time);
+
+    void addSlider(
+        const SliderPathT &path, HitObjectParams parameters, double time, double endTime, math::CurveType type,
+        unsigned int repeats
+    );
+
+    void addSpinner(
+        float spinRequired, float spinResistance, double time, double endTime, const fvec2d &position, bool free
+    );
+
+    void clear();
+    /// Drops the spare capacity left over from loading.
+    void shrinkToFit();
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const;
+
+    [[nodiscard]] std::span<const double> getStartTimes() const;
+    [[nodiscard]] std::span<const double> getEndTimes() const;
+    [[nodiscard]] std::span<const HitObjectType> getTypes() const;
+    [[nodiscard]] std::span<const HitObjectParams> getParameters() const;
+    // Where each note or spinner is, or where each slider starts.
+    [[nodiscard]] std::span<const fvec2d> getPositions() const;
+
+    /// The details of an object which is a slider.
+    [[nodiscard]] const SliderDetails &getSlider(size_t i) const;
+    /// The control points of an object which is a slider.
+    [[nodiscard]] std::span<const fvec2d> getPath(size_t i) const;
+    /// The details of an object which is a spinner.
+    [[nodiscard]] const SpinnerDetails &getSpinner(size_t i) const;
+
+    /**
+     * Builds the templates hit objects are created from, the object at i has to be of the matching type.
+     */
+    [[nodiscard]] std::shared_ptr<ObjectTemplateNote> makeNote(size_t i) const;
+    [[nodiscard]] std::shared_ptr<ObjectTemplateSlider> makeSlider(size_t i) const;
+    [[nodiscard]] std::shared_ptr<ObjectTemplateSpinner> makeSpinner(size_t i) const;
+
+    /// Bytes held by the columns, side tables and point buffer.
+    [[nodiscard]] size_t getMemoryUsage() const;
+
+private:
+    /// Makes room for an object starting at time, returns its index. Objects normally come in order and are appended.
+    size_t insert(double time);
+
+    std::vector<double> startTimes;
+    std::vector<double> endTimes;
+    std::vector<HitObjectType> types;
+    std::vector<HitObjectParams> parameters;
+    std::vector<fvec2d> positions;
+    // Index into sliders or spinners, depending on the type.
+    std::vector<uint32_t> details;
+
+    std::vector<SliderDetails> sliders;
+    std::vector<SpinnerDetails> spinners;
+    std::vector<fvec2d> points;
+};
+
+}
@@ -57,6 +57,7 @@ Note::Note(std::shared_ptr<ObjectTemplateNote> t, const HitObjectArguments& args
 {
 }
 
+#ifndef HEADLESS
 void Note::onDraw(video::LambdaRender& gfx)
 {
 	const auto& objectTransform = getObjectTransform();
@@ -77,6 +78,7 @@ void Note::onUpdate()
     noteOverlay.update(delta);
     noteUnderlay.update(delta);
 }
+#endif
 
 // getEndPosition will automatically return the start position since it's not been overridden
 fvec2d Note::getStartPosition() const
@@ -90,16 +92,20 @@ HitObjectFunction Note::getActivationFunction() const
 	return HitObjectFunction::BUTTON_PRESSED | HitObjectFunction::CURSOR_ENTER;
 }
 
+void Note::onPrepare()
+{
+    SOF = {getGame().getCircleSize(), objectTemplate->position};
+}
+
+#ifndef HEADLESS
 void Note::onCreate(Resource<Skin> &skin)
 {
     auto& args = getArguments();
-    auto& game = getGame();
-
-    SOF = {game.getCircleSize(), objectTemplate->position};
 
     noteBase = skin->createObjectSprite(NOTE_BASE_SPRITE, args);
     noteOverlay = skin->createObjectSprite(NOTE_OVERLAY_SPRITE, args);
     noteUnderlay = skin->createObjectSprite(NOTE_UNDERLAY_SPRITE, args);
 }
+#endif
 
 }
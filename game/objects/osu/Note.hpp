@@ -26,9 +26,12 @@
 
 #include "OsuHitObject.hpp"
 #include "HitObjectArguments.hpp"
-#include "ObjectSprite.hpp"
 #include "NoteTemplate.hpp"
 
+#ifndef HEADLESS
+#include "ObjectSprite.hpp"
+#endif
+
 namespace PROJECT_NAMESPACE {
 
 constexpr const char *NOTE_BASE_SPRITE = "note";
@@ -49,19 +52,26 @@ public:
 protected:
     void onReset() override;
 
+#ifndef HEADLESS
     void onUpdate() override;
 
     void onDraw(video::LambdaRender& gfx) override;
+#endif
 
     void onBegin() override;
 
     HitResult onFinish() override;
+    void onPrepare() override;
+#ifndef HEADLESS
     void onCreate(Resource<Skin> &resource) override;
+#endif
 private:
     bool wasHit = false;
+#ifndef HEADLESS
     ObjectSprite noteBase;
     ObjectSprite noteOverlay;
     ObjectSprite noteUnderlay;
+#endif
 };
 
 }
\ No newline at end of file
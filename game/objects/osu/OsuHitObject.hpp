@@ -51,6 +51,7 @@ public:
 	{}
 
 protected:
+#ifndef HEADLESS
 	void drawApproachCircle(video::LambdaRender& gfx)
 	{
 		// HACK: Since drawApproachCircle only gets called once during the draw, we can
@@ -79,6 +80,7 @@ protected:
 			}}, video::APPROACH_CIRCLES);
 		}
 	}
+#endif
 
 	[[nodiscard]] Mat3f calculateObjectTransform() const override
 	{
@@ -109,7 +111,9 @@ protected:
 
 private:
 	HitObjectArguments args;
+#ifndef HEADLESS
 	ObjectSprite approachCircle;
+#endif
 };
 
 }
\ No newline at end of file
@@ -21,12 +21,18 @@
  ******************************************************************************/
 #include "Slider.hpp"
 
+#include "Parallel.hpp"
+
+#ifndef HEADLESS
 #include "SliderTrail.hpp"
+#endif
 
 #include <utility>
+#include <vector>
 
 namespace PROJECT_NAMESPACE {
 
+#ifndef HEADLESS
 void Slider::onUpdate()
 {
     double delta = getGame().getDelta();
@@ -41,6 +47,7 @@ void Slider::onUpdate()
     ballOverlay.update(delta);
     ballUnderlay.update(delta);
 }
+#endif
 
 void Slider::onLogicUpdate()
 {
@@ -134,6 +141,7 @@ Slider::Slider(std::shared_ptr<ObjectTemplateSlider> templateIn, const HitObject
       broken(false), started(false), progression(0.0), curvePosition(0.0)
 {}
 
+#ifndef HEADLESS
 void Slider::onDraw(video::LambdaRender& gfx)
 {
     auto& game = getGame();
@@ -274,6 +282,7 @@ void Slider::onDraw(video::LambdaRender& gfx)
         gfx.draw(DrawObject{ballRing, ringInfo});
     }
 }
+#endif
 
 void Slider::onReset()
 {
@@ -326,13 +335,11 @@ HitObjectFunction Slider::getActivationFunction() const
         return HitObjectFunction::CURSOR_ENTER | HitObjectFunction::BUTTON_HELD;
     }
 }
+#ifndef HEADLESS
 void Slider::onCreate(Resource<Skin> &skin)
 {
-    auto& game = getGame();
     auto& args = getArguments();
 
-    startPoint = getStartTime();
-
     bodyShader = skin->getShader(SLIDER_SHADER);
     bodyTexture = skin->createObjectSprite(SLIDER_BODY_SPRITE, args);
     ball = skin->createObjectSprite(SLIDER_BALL_SPRITE, args);
@@ -344,6 +351,14 @@ void Slider::onCreate(Resource<Skin> &skin)
     tail = skin->createObjectSprite(SLIDER_TAIL_SPRITE, args);
     tailRepeat = skin->createObjectSprite(SLIDER_TAIL_REPEAT_SPRITE, args);
     hitPoint = skin->createObjectSprite(SLIDER_HIT_POINT_SPRITE, args);
+}
+#endif
+
+void Slider::onPrepare()
+{
+    auto& game = getGame();
+
+    startPoint = getStartTime();
 
     /*============================================================================================================*/
     // Initialize the variables to their defaults.
@@ -363,11 +378,15 @@ void Slider::onCreate(Resource<Skin> &skin)
     auto steps =
         math::Max((unsigned int) (SLIDER_STEPS_PER_CURVE_UNIT * templateCurve.getLength()), 2);
 
-    // Interpolate over n * length steps.
-    for (unsigned int i = 0; i <= steps; i++) {
-        const auto t = double(i) / double(steps);
+    // Sample the curve over n * length steps, every sample is independent so spread them over the pool.
+    std::vector<fvec2d> samples(steps + 1);
+    tasks::ParallelFor(0u, steps + 1, SLIDER_SAMPLES_PER_TASK, [&](unsigned int i)
+    {
+        samples[i] = templateCurve.get(objectTemplate->sliderType, double(i) / double(steps));
+    });
 
-        fvec2d thisPosition = templateCurve.get(objectTemplate->sliderType, t);
+    for (unsigned int i = 0; i <= steps; i++) {
+        fvec2d thisPosition = samples[i];
 
         // meshSpine.push_back(thisPosition);
 
@@ -66,6 +66,9 @@ constexpr double SLIDER_DISTANCE_OPT_THRESHOLD = 0.1;
 
 constexpr unsigned int SLIDER_STEPS_PER_CURVE_UNIT = 30;
 
+// Curve samples per pool task, short sliders are sampled on the calling thread.
+constexpr unsigned int SLIDER_SAMPLES_PER_TASK = 512;
+
 class Slider: public OsuHitObject<ObjectTemplateSlider>
 {
 public:
@@ -82,14 +85,19 @@ protected:
 	{
 		Forward, Backward
 	};
+    void onPrepare() override;
+#ifndef HEADLESS
     void onCreate(Resource<Skin> &resource) override;
+#endif
     [[nodiscard]] fvec2d findDirection(double t);
 
     [[nodiscard]] fvec2d findNormal(double t);
 
     void onReset() override;
 
+#ifndef HEADLESS
 	void onUpdate() override;
+#endif
 
     void onLogicUpdate() override;
 
@@ -99,11 +107,14 @@ protected:
 
     void onRaise() override;
 
+#ifndef HEADLESS
     void onDraw(video::LambdaRender& gfx) override;
+#endif
 
     void onPress() override;
 
 private:
+#ifndef HEADLESS
     Resource<video::Shader> bodyShader;
 
     Resource<video::Texture> preBakedTexture;
@@ -118,6 +129,7 @@ private:
     ObjectSprite tail;
     ObjectSprite tailRepeat;
     ObjectSprite hitPoint;
+#endif
 
     // the interpolated path
     SliderPathT interpolatedPath;
@@ -44,11 +44,13 @@ void Spinner::onLogicUpdate()
         lastVector = cursor;
     }
 
-	float x = float(time::SinceStart()) * 30.f;
+	// follows the game clock rather than the wall clock, so a replay judges the same however fast it runs
+	float x = float(game.getCurrentTime()) * 30.f;
 	const float outset = 0.25f;
 	SOF.position = fvec2d{std::cos(x) * outset, std::sin(x) * outset};
 }
 
+#ifndef HEADLESS
 void Spinner::onUpdate()
 {
     // update texture animations
@@ -57,6 +59,7 @@ void Spinner::onUpdate()
     spinnerCenter.update(delta);
     spinnerMeter.update(delta);
 }
+#endif
 
 void Spinner::onBegin()
 {
@@ -81,6 +84,7 @@ void Spinner::onPress()
     lastVector = math::Normalize(getGame().getCursorPosition());
 }
 
+#ifndef HEADLESS
 void Spinner::onDraw(video::LambdaRender& gfx)
 {
     auto alpha = getAlpha();
@@ -98,6 +102,7 @@ void Spinner::onDraw(video::LambdaRender& gfx)
     gfx.draw(DrawObject{spinner, spinnerInfo});
 	gfx.draw(DrawObject{spinnerCenter, spinnerCenterInfo});
 }
+#endif
 
 void Spinner::onReset()
 {
@@ -115,6 +120,12 @@ HitObjectFunction Spinner::getDeactivationFunction() const
 {
 	return HitObjectFunction::BUTTON_RELEASED | HitObjectFunction::CURSOR_IGNORE;
 }
+void Spinner::onPrepare()
+{
+    SOF = {objectTemplate->free ? getGame().getCircleSize() : 2.0f, objectTemplate->position};
+}
+
+#ifndef HEADLESS
 void Spinner::onCreate(Resource<Skin> &skin)
 {
     auto& args = getArguments();
@@ -122,8 +133,7 @@ void Spinner::onCreate(Resource<Skin> &skin)
     spinner = skin->createObjectSprite(SPINNER_SPRITE, args);
     spinnerCenter = skin->createObjectSprite(SPINNER_CENTER_SPRITE, args);
     spinnerMeter = skin->createObjectSprite(SPINNER_METER_SPRITE, args);
-
-    SOF = {objectTemplate->free ? getGame().getCircleSize() : 2.0f, objectTemplate->position};
 }
+#endif
 
 }
\ No newline at end of file
@@ -50,23 +50,32 @@ public:
 	[[nodiscard]] HitObjectFunction getActivationFunction() const override;
 
 protected:
+#ifndef HEADLESS
     void onDraw(video::LambdaRender& gfx) override;
+#endif
 
     void onLogicUpdate() override;
 
+#ifndef HEADLESS
     void onUpdate() override;
+#endif
 
     void onBegin() override;
 
     void onPress() override;
+    void onPrepare() override;
+#ifndef HEADLESS
     void onCreate(Resource<Skin> &resource) override;
+#endif
     HitResult onFinish() override;
 
     void onReset() override;
 private:
+#ifndef HEADLESS
     ObjectSprite spinner;
     ObjectSprite spinnerCenter;
     ObjectSprite spinnerMeter;
+#endif
     float RPM;
     float rotationAccum;
     unsigned int rotationsCompleted;
@@ -22,9 +22,11 @@
 
 #pragma once
 
-#include "HitObject.hpp"
 #include "define.hpp"
 
+#include "BaseObjectTemplate.hpp"
+#include "Vector.hpp"
+
 namespace PROJECT_NAMESPACE {
 
 BEGIN_OBJECT_TEMPLATE(Spinner)
@@ -23,6 +23,7 @@
 #include "StateMainMenu.hpp"
 
 #include "Log.hpp"
+#include "DebugMenus.hpp"
 
 #include "Import.hpp"
 #include "Rect.hpp"
@@ -80,7 +81,6 @@ void State<GameState::MainMenu>::showDebugControl()
                             log::Info("Importing from ", install.path);
                             showImportDialog = false;
                             compat::ImportOsuData(install.path);
-                            ctx->maps.clear();
                             ctx->maps.load(ctx->paths);
                         }
                     }
@@ -189,8 +189,20 @@ void State<GameState::MainMenu>::showDebugControl()
             ImGui::Text("loaded maps: %lu", loaded);
             ImGui::Text("remaining: %lu", remaining);
             ImGui::Text("total: %lu", loaded+remaining);
+            ImGui::Text("unrated: %lu", ctx->maps.unrated());
             ImGui::Separator();
             ImGui::Text("active tasks: %lu", tasks::GetTaskQueueLength());
+            ImGui::Text(
+                "realtime: %lu, interactive: %lu, background: %lu",
+                tasks::GetTaskQueueLength(tasks::Priority::Realtime),
+                tasks::GetTaskQueueLength(tasks::Priority::Interactive),
+                tasks::GetTaskQueueLength(tasks::Priority::Background)
+            );
+            auto allocations = tasks::GetAllocationStats();
+            ImGui::Text(
+                "task heap allocations: %lu, pooled: %lu, reserved: %lu KiB",
+                allocations.heapAllocations, allocations.pooledAllocations, allocations.bytesReserved / 1024
+            );
             auto infos = tasks::GetThreadStates();
             if (ImGui::BeginTable("##threadinfo", 4)) {
                 for (size_t i = 0; i < infos.size(); i++) {
@@ -226,6 +238,11 @@ void State<GameState::MainMenu>::showDebugControl()
             ImGui::EndTabItem();
         }
 
+        if (ImGui::BeginTabItem("ui.main.trace.title"_i18n.c_str())) {
+            DrawTaskTrace();
+            ImGui::EndTabItem();
+        }
+
         ImGui::EndTabBar();
     }
 }
@@ -283,7 +300,11 @@ void State<GameState::MainMenu>::showMainMenuTab()
 
     static unsigned int selected = -1;
 
-    static ImGuiTextFilter filter;
+    static std::string query;
+    // matches of the last query, searched again only when the query or the library changes
+    static std::vector<uint32_t> visible;
+    static std::string visibleQuery;
+    static uint64_t visibleVersion = -1;
 
     const float playButtonWidth = 60.f;
     auto size = (fsize) ctx->gfx.getConfig().size;
@@ -293,15 +314,22 @@ void State<GameState::MainMenu>::showMainMenuTab()
     }
     ImGui::SameLine();
     if (ImGui::Button("ui.main.maps.reload"_i18n.c_str())) {
-        ctx->maps.clear();
         ctx->maps.load(ctx->paths);
     }
     ImGui::SameLine();
     ImGui::Text("%s", "ui.main.maps.filter"_i18n.c_str());
     ImGui::SameLine();
-    filter.Draw("##", -1);
+    ImGui::SetNextItemWidth(-1);
+    ImGui::InputText("##", &query);
     ImGui::Separator();
 
+    const auto &searchIndex = ctx->maps.getSearchIndex();
+    if (query != visibleQuery || searchIndex.getVersion() != visibleVersion) {
+        visible = searchIndex.find(query);
+        visibleQuery = query;
+        visibleVersion = searchIndex.getVersion();
+    }
+
     if (ImGui::BeginTable(
         "##", 9,
         ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY,
@@ -342,110 +370,108 @@ void State<GameState::MainMenu>::showMainMenuTab()
 
         const float iconSize = 16;
 
-        for (unsigned int i = 0; i < ctx->maps.size(); i++) {
+        for (unsigned int i : visible) {
             const auto &map = ctx->maps.at(i);
 
-            auto filterName = map->romanisedName + " " + map->romanisedArtist + " " + map->difficulty;
-
-            if (filter.PassFilter(filterName.c_str())) {
-
-                // The play button
-                ImGui::TableNextColumn();
-                if (i == selected) {
-                    if (ImGui::Button("Play!", {playButtonWidth, 0})) {
-                        ctx->game.setMap(map);
-                        setState(GameState::InGame);
-                    }
-                }
-                // Song star rating
-                ImGui::TableNextColumn();
-                char starRating[8] = "???";
-                ImGui::Text("%s", starRating);
-                ImGui::SameLine();
-                ImGui::Image(star->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0}, {0.8, 0.8, 0, 1});
-
-                // Song name and selectable field
-                ImGui::TableNextColumn();
-                std::string itemID = "##" + std::to_string(i);
-                if (ImGui::Selectable(itemID.c_str(), false, ImGuiSelectableFlags_None)) {
-                    selectedMap = map;
-                    auto &channel = ctx->audio.getMusicChannel();
-                    radio = Load<SoundStream>(map->getDirectory() / map->songPath);
-                    channel.setSound(radio.ref(), true);
-                    auto bg = ctx->menuBG.lock();
-                    if (bg) {
-                        bg->setImageBackground(Load<video::Texture>(map->getDirectory() / map->backgroundPath));
-                    }
-                    selected = i;
-                }
-                ImGui::SameLine();
-                auto name =
-                    map->romanisedName + " - " + map->romanisedArtist + " (" + map->difficulty + ')';
-                if (name.empty()) {
-                    name = "#unknown_" + std::to_string(long(map.get()));
+            // The play button
+            ImGui::TableNextColumn();
+            if (i == selected) {
+                if (ImGui::Button("Play!", {playButtonWidth, 0})) {
+                    ctx->game.setMap(selectedMap);
+                    setState(GameState::InGame);
                 }
-                ImGui::Text("%s", name.c_str());
-
-                // Song overall difficulty
-                ImGui::TableNextColumn();
-                ImGui::Image(difficulty->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
-                ImGui::SameLine();
-                char overallDiff[8];
-                sprintf(overallDiff, "%.1f", map->overallDifficulty);
-                ImGui::Text("%s", overallDiff);
-
-                // Song approach time
-                ImGui::TableNextColumn();
-                ImGui::Image(approach->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
-                ImGui::SameLine();
-                char approachTime[8];
-                sprintf(approachTime, "%.1f", map->approachTime);
-                ImGui::Text("%s", approachTime);
-
-                // Song circle size
-                ImGui::TableNextColumn();
-                ImGui::Image(circle->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
-                ImGui::SameLine();
-                char circleSize[8];
-                sprintf(circleSize, "%.2f", map->circleSize);
-                ImGui::Text("%s", circleSize);
-
-                // Song hit window time
-                ImGui::TableNextColumn();
-                ImGui::Image(window->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
-                ImGui::SameLine();
-                char hitWindow[8];
-                sprintf(hitWindow, "%.1f", map->hitWindow);
-                ImGui::Text("%s", hitWindow);
-
-                // Song HP drain
-                ImGui::TableNextColumn();
-                ImGui::Image(drain->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
-                ImGui::SameLine();
-                char hpDrain[8];
-                sprintf(hpDrain, "%.1f", map->HPDrain);
-                ImGui::Text("%s", hpDrain);
-
-                // Song duration
-                ImGui::TableNextColumn();
-                ImGui::Image(duration->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
-                ImGui::SameLine();
-
-                auto secsTotal = (int) map->mapDuration;
-                int secs = secsTotal % 60;
-                int minutes = secsTotal / 60;
-                int hours = secsTotal / 3600;
-
-                char mapDuration[32];
-                if (hours == 0) {
-                    sprintf(mapDuration, "%i:%02i", minutes, secs);
-                } else {
-                    sprintf(mapDuration, "%i:%02i:%02i", hours, minutes, secs);
+            }
+            // Song star rating
+            ImGui::TableNextColumn();
+            char starRating[8] = "???";
+            if (map.starRating >= 0.0f) {
+                sprintf(starRating, "%.2f", map.starRating);
+            }
+            ImGui::Text("%s", starRating);
+            ImGui::SameLine();
+            ImGui::Image(star->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0}, {0.8, 0.8, 0, 1});
+
+            // Song name and selectable field
+            ImGui::TableNextColumn();
+            std::string itemID = "##" + std::to_string(i);
+            if (ImGui::Selectable(itemID.c_str(), false, ImGuiSelectableFlags_None)) {
+                selectedMap = ctx->maps.open(i);
+                auto &channel = ctx->audio.getMusicChannel();
+                radio = Load<SoundStream>(map.getDirectory() / map.songPath);
+                channel.setSound(radio.ref(), true);
+                auto bg = ctx->menuBG.lock();
+                if (bg) {
+                    bg->setImageBackground(Load<video::Texture>(map.getDirectory() / map.backgroundPath));
                 }
+                selected = i;
+            }
+            ImGui::SameLine();
+            auto name =
+                map.romanisedName + " - " + map.romanisedArtist + " (" + map.difficulty + ')';
+            if (name.empty()) {
+                name = "#unknown_" + std::to_string(i);
+            }
+            ImGui::Text("%s", name.c_str());
+
+            // Song overall difficulty
+            ImGui::TableNextColumn();
+            ImGui::Image(difficulty->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
+            ImGui::SameLine();
+            char overallDiff[8];
+            sprintf(overallDiff, "%.1f", map.overallDifficulty);
+            ImGui::Text("%s", overallDiff);
+
+            // Song approach time
+            ImGui::TableNextColumn();
+            ImGui::Image(approach->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
+            ImGui::SameLine();
+            char approachTime[8];
+            sprintf(approachTime, "%.1f", map.approachTime);
+            ImGui::Text("%s", approachTime);
+
+            // Song circle size
+            ImGui::TableNextColumn();
+            ImGui::Image(circle->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
+            ImGui::SameLine();
+            char circleSize[8];
+            sprintf(circleSize, "%.2f", map.circleSize);
+            ImGui::Text("%s", circleSize);
 
-                ImGui::Text("%s", mapDuration);
-                ImGui::TableNextRow();
+            // Song hit window time
+            ImGui::TableNextColumn();
+            ImGui::Image(window->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
+            ImGui::SameLine();
+            char hitWindow[8];
+            sprintf(hitWindow, "%.1f", map.hitWindow);
+            ImGui::Text("%s", hitWindow);
+
+            // Song HP drain
+            ImGui::TableNextColumn();
+            ImGui::Image(drain->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
+            ImGui::SameLine();
+            char hpDrain[8];
+            sprintf(hpDrain, "%.1f", map.HPDrain);
+            ImGui::Text("%s", hpDrain);
+
+            // Song duration
+            ImGui::TableNextColumn();
+            ImGui::Image(duration->getGLData(), {iconSize, iconSize}, {0, 1}, {1, 0});
+            ImGui::SameLine();
+
+            auto secsTotal = (int) map.mapDuration;
+            int secs = secsTotal % 60;
+            int minutes = secsTotal / 60;
+            int hours = secsTotal / 3600;
+
+            char mapDuration[32];
+            if (hours == 0) {
+                sprintf(mapDuration, "%i:%02i", minutes, secs);
+            } else {
+                sprintf(mapDuration, "%i:%02i:%02i", hours, minutes, secs);
             }
+
+            ImGui::Text("%s", mapDuration);
+            ImGui::TableNextRow();
         }
         ImGui::EndTable();
     }
@@ -33,4 +33,9 @@ bool LoadMAP(const std::filesystem::path& fpath, MapInfo &map);
 
 bool LoadOSU(const std::filesystem::path &pathIn, MapInfo &map);
 
+/**
+ * Reads the sections of an .osu file preceding its hit objects.
+ */
+bool LoadOSUHeader(const std::filesystem::path &pathIn, MapHeader &header);
+
 }
\ No newline at end of file
@@ -22,16 +22,18 @@
 
 #include "MapLoaders.hpp"
 
+#include "Files.hpp"
+#include "ZipArchive.hpp"
 #include "MapInfo.hpp"
+#include "TimingTimeline.hpp"
 #include "Vector.hpp"
 #include "define.hpp"
 #include "Util.hpp"
 
 #include <cmath>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <map>
 
 namespace PROJECT_NAMESPACE {
@@ -39,32 +41,23 @@ namespace PROJECT_NAMESPACE {
 class OSUMapLoader
 {
 public:
+    // All string_views point into the mapped file, or the unpacked archive member, and are only valid while the loader
+    // is alive.
     struct HitObject
     {
         fvec2d position;
         double time;
         int type;
         int hitSound;
-        std::vector<std::string> objectParams;
-        std::vector<std::string> hitSample;
+        std::string_view objectParams;
+        std::string_view hitSample;
     };
 
     struct Event
     {
         int type;
         double time;
-        std::vector<std::string> params;
-    };
-
-    struct TimingPoint
-    {
-        double time;
-        double beatLength;
-        int meter;
-        int sampleSet;
-        int sampleIndex;
-        int volume;
-        int effects;
+        std::string_view params;
     };
 
     enum Section
@@ -85,60 +78,96 @@ public:
     static float TimeConversion(int t)
     { return float(t) / 1000.f; }
 
-    static std::string ReadRestOfStream(std::stringstream &stream)
+    static HitObject ParseHitObject(std::string_view line)
     {
-        std::string text;
-        while (!stream.eof()) {
-            std::string chunk;
-            stream >> chunk;
-            text.append(chunk + " ");
+        HitObject object{};
+
+        // x, y, time, type, hitSound, objectParams, hitSample
+        object.position[0] = ParseNumber<float>(PopSeparatedValue(line, ','), 0);
+        object.position[1] = ParseNumber<float>(PopSeparatedValue(line, ','), 0);
+        object.position = PosConversion(object.position);
+        object.time = TimeConversion(ParseNumber<int>(PopSeparatedValue(line, ','), 0));
+        object.type = ParseNumber<int>(PopSeparatedValue(line, ','), 1);
+        object.hitSound = ParseNumber<int>(PopSeparatedValue(line, ','), 0);
+        if (!line.empty()) {
+            auto lastSeparator = line.rfind(',');
+            auto last = lastSeparator == std::string_view::npos ? line : line.substr(lastSeparator + 1);
+            if (last.find(':') != std::string_view::npos) {
+                object.hitSample = last;
+                if (lastSeparator != std::string_view::npos) {
+                    object.objectParams = line.substr(0, lastSeparator);
+                }
+            } else {
+                object.objectParams = line;
+            }
         }
-        return text;
+
+        return object;
     }
 
-    bool read(const std::filesystem::path &path)
+    /// The end of sliders depends on the timing points, their start is close enough for the map's length.
+    static double ObjectEndTime(const HitObject &object)
     {
-        std::ifstream ifs(path);
-
-        if (!ifs.is_open()) {
-            log::Error("Unable to open file");
-            return false;
+        if (object.type & 1 << 3) {
+            auto params = object.objectParams;
+            return TimeConversion(ParseNumber<int>(PopSeparatedValue(params, ','), int(object.time * 1000.0)));
         }
+        return object.time;
+    }
 
-        std::string strLine;
-        std::istringstream line(strLine);
+    /**
+     * Reads the map file.
+     * @param path Path to the file.
+     * @param headerOnly Stop at the hit objects, only the last one is read to find out the map's length.
+     */
+    bool read(const std::filesystem::path &path, bool headerOnly = false)
+    {
+        std::string_view contents;
+        if (auto member = files::SplitArchivePath(path)) {
+            if (!files::ReadArchiveMember(*member, unpacked)) {
+                log::Error("Unable to read ", path, " from its archive");
+                return false;
+            }
+            contents = unpacked;
+        } else {
+            if (!file.open(path)) {
+                log::Error("Unable to open file");
+                return false;
+            }
+            contents = file.view();
+        }
 
         Section section = DONT_CARE;
 
-        std::stringstream slurped;
-        slurped << ifs.rdbuf();
-        ifs.close();
+        std::string_view remaining = contents;
 
-        while (!slurped.eof()) {
-            std::getline(slurped, strLine);
-            Trim(strLine);
+        while (!remaining.empty()) {
+            auto line = TrimView(PopSeparatedValue(remaining, '\n'));
 
-            if (strLine.empty()) {
+            if (line.empty()) {
                 continue;
             }
 
-            if (strLine.starts_with('[')) {
-                Trim(strLine);
-                if (strLine == "[HitObjects]") {
+            if (line.starts_with('[')) {
+                if (line == "[HitObjects]") {
+                    if (headerOnly) {
+                        readLastObjectTime(remaining);
+                        return true;
+                    }
                     section = HIT_OBJECTS;
-                } else if (strLine == "[General]") {
+                } else if (line == "[General]") {
                     section = GENERAL;
-                } else if (strLine == "[Metadata]") {
+                } else if (line == "[Metadata]") {
                     section = METADATA;
-                } else if (strLine == "[TimingPoints]") {
+                } else if (line == "[TimingPoints]") {
                     section = TIMING_POINTS;
-                } else if (strLine == "[Editor]") {
+                } else if (line == "[Editor]") {
                     section = EDITOR;
-                } else if (strLine == "[Difficulty]") {
+                } else if (line == "[Difficulty]") {
                     section = DIFFICULTY;
-                } else if (strLine == "[Events]") {
+                } else if (line == "[Events]") {
                     section = EVENTS;
-                } else if (strLine == "[Colours]") {
+                } else if (line == "[Colours]") {
                     section = COLOURS;
                 } else {
                     section = DONT_CARE;
@@ -146,53 +175,27 @@ public:
                 continue;
             }
 
-            line = std::istringstream(strLine);
-
             switch (section) {
                 case HIT_OBJECTS: {
-                    HitObject object{};
-
-                    // x, y, time, type, hitSound, objectParams, hitSample
-                    auto params = GetCharacterSeparatedValues(strLine, ',');
-                    object.position[0] = GetParam<float>(params, 0, 0);
-                    object.position[1] = GetParam<float>(params, 1, 0);
-                    object.position = PosConversion(object.position);
-                    object.time = TimeConversion(GetParam<int>(params, 2, 0));
-                    object.type = GetParam<int>(params, 3, 1);
-                    object.hitSound = GetParam<int>(params, 4, 0);
-                    if (params.size() > 5) {
-                        if (params.back().find(':') != std::string::npos) {
-                            object.hitSample = GetCharacterSeparatedValues(params.back(), ':');
-                            object.objectParams = std::vector(std::next(params.begin(), 5), std::prev(params.end()));
-                        } else {
-                            object.objectParams = std::vector(std::next(params.begin(), 5), params.end());
-                        }
-                    }
-
-                    hitObjectParams.push_back(std::move(object));
+                    hitObjectParams.push_back(ParseHitObject(line));
                     break;
                 }
                 case TIMING_POINTS: {
-                    TimingPoint point{};
-
                     // time, beatLength, meter, sampleSet, sampleIndex, volume, uninherited, effects
-                    auto params = GetCharacterSeparatedValues(strLine, ',');
-
-                    point.time = TimeConversion(GetParam<int>(params, 0, 0));
-                    point.beatLength = GetParam<double>(params, 1, 100);
-                    point.meter = GetParam<int>(params, 2, 4);
-                    point.sampleSet = GetParam<int>(params, 3, 0);
-                    point.sampleIndex = GetParam<int>(params, 4, 0);
-                    point.volume = GetParam<int>(params, 5, 100);
-                    point.effects = GetParam<int>(params, 7, 0);
-
-                    bool unInherited = GetParam<int>(params, 6, 1);
+                    double time = TimeConversion(ParseNumber<int>(PopSeparatedValue(line, ','), 0));
+                    double beatLength = ParseNumber<double>(PopSeparatedValue(line, ','), 100);
+                    int meter = ParseNumber<int>(PopSeparatedValue(line, ','), 4);
+                    // sampleSet, sampleIndex and volume are not used
+                    for (int i = 0; i < 3; i++) {
+                        PopSeparatedValue(line, ',');
+                    }
+                    bool unInherited = ParseNumber<int>(PopSeparatedValue(line, ','), 1);
 
                     if (unInherited) {
-                        point.beatLength = TimeConversion((int) point.beatLength);
-                        uninheritedTimingPoints.push_back(point);
+                        timeline.addTimingPoint(TimingPoint{time, TimeConversion((int) beatLength), meter});
                     } else {
-                        inheritedTimingPoints.push_back(point);
+                        // inherited points store the velocity as a negative inverse percentage
+                        timeline.addVelocityPoint(VelocityPoint{time, 100.0 / -beatLength});
                     }
 
                     break;
@@ -200,35 +203,31 @@ public:
                 case GENERAL:
                 case METADATA:
                 case DIFFICULTY: {
-                    auto values = GetCharacterSeparatedValues(strLine, ':');
-                    if (values.size() >= 2) {
-                        auto &key = values[0];
-                        auto &value = values[1];
-
-                        Trim(key);
-                        Trim(value);
-
-                        meta[key] = value;
+                    // the value is everything after the first colon, titles may well contain more of them
+                    auto separator = line.find(':');
+                    if (separator != std::string_view::npos) {
+                        auto key = TrimView(line.substr(0, separator));
+                        auto value = TrimView(line.substr(separator + 1));
+                        if (!value.empty()) {
+                            meta[key] = value;
+                        }
                     }
                     break;
                 }
                 case EVENTS: {
-                    auto params = GetCharacterSeparatedValues(strLine, ',');
-                    Event ev;
-                    ev.type = GetParam<int>(params, 0, -1);
+                    Event ev{};
+                    auto type = PopSeparatedValue(line, ',');
+                    ev.type = ParseNumber<int>(type, -1);
                     if (ev.type == -1) {
                         // the event type, might be a string
-                        auto videoException = GetParam<std::string>(params, 0, "");
-                        if (videoException == "Video") {
+                        if (type == "Video") {
                             ev.type = 1;
                         } else {
                             break;
                         }
                     }
-                    ev.time = TimeConversion(GetParam<int>(params, 1, 0));
-                    if (params.size() > 2) {
-                        ev.params = std::vector(std::next(params.begin(), 2), std::prev(params.end()));
-                    }
+                    ev.time = TimeConversion(ParseNumber<int>(PopSeparatedValue(line, ','), 0));
+                    ev.params = line;
                     events.push_back(ev);
                     break;
                 }
@@ -239,28 +238,27 @@ public:
             }
         }
 
+        if (!hitObjectParams.empty()) {
+            lastObjectTime = ObjectEndTime(hitObjectParams.back());
+        }
+
         return true;
     }
 
     template<typename T>
-    T getField(const std::string &name, T backup)
+    auto getField(std::string_view name, T backup)
     {
-        if (meta.contains(name)) {
-            if constexpr (std::is_same_v<T, std::string>) {
-                return meta[name];
-            } else if constexpr (std::is_same_v<T, const char *>) {
-                return meta[name].c_str();
-            } else if constexpr (std::is_arithmetic_v<T>) {
-                return static_cast<T>(std::strtod(meta[name].c_str(), nullptr));
-            } else {
-                return backup;
-            }
+        auto it = meta.find(name);
+        if constexpr (std::is_arithmetic_v<T>) {
+            return it != meta.end() ? ParseNumber<T>(it->second, backup) : backup;
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            return it != meta.end() ? it->second : backup;
+        } else {
+            return std::string(it != meta.end() ? it->second : std::string_view(backup));
         }
-
-        return backup;
     }
 
-    void operator()(MapInfo &map)
+    void readHeader(MapHeader &map)
     {
         /*
         https://osu.ppy.sh/wiki/en/Client/File_formats/Osu_(file_format)
@@ -334,8 +332,6 @@ public:
         map.approachTime =
             1.8f - math::Min(approachLevel, 5) * 0.12f - (approachLevel > 5 ? (approachLevel - 5) * 0.15f : 0);
 
-        sliderMultiplier = getField("SliderMultiplier", 1.0f);
-
         map.songPath = getField("AudioFilename", "audio.mp3");
         map.startOffset = TimeConversion(getField("AudioLeadIn", 0));
         map.name = getField("TitleUnicode", "");
@@ -345,8 +341,42 @@ public:
         map.source = getField("Source", "");
         map.author = getField("Creator", "");
         map.difficulty = getField("Version", "");
-        std::string tags = getField("Tags", "");
-        map.tags = GetCharacterSeparatedValues(tags, ' ');
+        std::string_view tags = getField<std::string_view>("Tags", "");
+        while (!tags.empty()) {
+            auto tag = PopSeparatedValue(tags, ' ');
+            if (!tag.empty()) {
+                map.tags.emplace_back(tag);
+            }
+        }
+
+        for (const auto& ev : events) {
+            switch (ev.type) {
+            case 0: {// map background is the only one we care about
+                // TODO: Read the background offset as well
+                auto params = ev.params;
+                auto arg = std::string(PopSeparatedValue(params, ','));
+                RemoveAll(arg, "\"");
+                map.backgroundPath = arg;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        if (lastObjectTime > 0) {
+            map.mapDuration = lastObjectTime;
+        }
+    }
+
+    void operator()(MapInfo &map)
+    {
+        readHeader(map);
+
+        sliderMultiplier = getField("SliderMultiplier", 1.0f);
+
+        // hit objects are sorted, the cursor only ever has to step forward through the timing points
+        TimingTimeline::Cursor timing;
 
         for (auto it = hitObjectParams.begin(); it != hitObjectParams.end(); it++) {
             const auto &object = *it;
@@ -362,38 +392,36 @@ public:
                 map.addNote(object.position, comboEnd, object.time);
             } else if (object.type & 1 << 1) {
                 // slider
+                // curveType|curvePoints, slides, length, edgeSounds, edgeSets
+                auto params = object.objectParams;
+                auto curve = PopSeparatedValue(params, ',');
+                int repeats = math::Max(ParseNumber<int>(PopSeparatedValue(params, ','), 1), 1);
+                auto length = ParseNumber<double>(PopSeparatedValue(params, ','), 0);
+
+                auto curveType = PopSeparatedValue(curve, '|');
+
                 SliderPathT path;
                 path.push_back(SliderNode{object.position, false});
 
-                auto curveParams = GetCharacterSeparatedValues(GetParam<std::string>(object.objectParams, 0, ""), '|');
-
-                for (unsigned int i = 1; i < curveParams.size(); i++) {
-                    const auto &param = curveParams[i];
-                    auto components = GetCharacterSeparatedValues(param, ':');
-                    fvec2d position = {
-                        GetParam<float>(components, 0, 0),
-                        GetParam<float>(components, 1, 0)
-                    };
+                while (!curve.empty()) {
+                    auto node = PopSeparatedValue(curve, '|');
+                    fvec2d position;
+                    position[0] = ParseNumber<float>(PopSeparatedValue(node, ':'), 0);
+                    position[1] = ParseNumber<float>(node, 0);
                     position = PosConversion(position);
                     path.push_back(SliderNode{position, false});
                 }
 
-                auto length = GetParam<double>(object.objectParams, 2, 0);
-
-                int repeats = math::Max(GetParam<int>(object.objectParams, 1, 1), 1);
-
-                double SV = getSliderVelocity(object.time);
-                double beat = getBeatLength(object.time);
+                double SV = timing.velocityAt(timeline, object.time);
+                double beat = timing.timingAt(timeline, object.time).beatLength;
                 double duration = length / (sliderMultiplier * 100.0 * SV) * beat;
                 duration *= repeats;
                 double endTime = object.time + duration;
 
                 math::CurveType type;
 
-                auto curveType = GetParam<std::string>(curveParams, 0, "");
-
                 // TODO: uncomment once all types of curve interpolation are finished
-                switch (curveType.front()) {
+                switch (curveType.empty() ? '\0' : curveType.front()) {
                     case 'B':type = math::CurveType::BEZIER;
                         break;
                     case 'C':type = math::CurveType::BEZIER;
@@ -410,62 +438,39 @@ public:
             } else if (object.type & 1 << 3) {
                 // spinner
                 // x,y,time,type,hitSound,endTime,hitSample
+                auto params = object.objectParams;
                 map.addSpinner(
                     0, 0, object.time,
-                    TimeConversion(GetParam<int>(object.objectParams, 0, int(object.time * 1000.0))));
+                    TimeConversion(ParseNumber<int>(PopSeparatedValue(params, ','), int(object.time * 1000.0))));
             }
         }
 
-        for (const auto& ev : events) {
-            switch (ev.type) {
-            case 0: {// map background is the only one we care about
-                // TODO: Read the background offset as well
-                auto arg = GetParam<std::string>(ev.params, 0, "");
-                RemoveAll(arg, "\"");
-                map.backgroundPath = arg;
-                break;
-            }
-            default:
-                break;
-            }
-        }
+        map.timing = std::move(timeline);
     }
 
 private:
-    float getSliderVelocity(double time)
+    void readLastObjectTime(std::string_view hitObjects)
     {
-        for (auto it = inheritedTimingPoints.begin(); it != inheritedTimingPoints.end(); it++) {
-            if (it != std::prev(inheritedTimingPoints.end())) {
-                if (math::InRangeIE(time, it->time, std::next(it)->time)) {
-                    return 1.f / ((float(it->beatLength) * -1.f) / 100.f);
-                }
-            } else {
-                return 1.f / ((float(it->beatLength) * -1.f) / 100.f);
-            }
+        auto line = TrimView(hitObjects);
+        auto lineStart = line.find_last_of('\n');
+        if (lineStart != std::string_view::npos) {
+            line = TrimView(line.substr(lineStart + 1));
         }
-        return 1.0f;
-    }
 
-    double getBeatLength(double time)
-    {
-        for (auto it = uninheritedTimingPoints.begin(); it != uninheritedTimingPoints.end(); it++) {
-            if (it != std::prev(uninheritedTimingPoints.end())) {
-                if (math::InRangeIE(time, it->time, std::next(it)->time)) {
-                    return it->beatLength;
-                }
-            } else {
-                return it->beatLength;
-            }
+        // the last line is only usable if the hit objects are the final section
+        if (!line.empty() && !line.starts_with('[')) {
+            lastObjectTime = ObjectEndTime(ParseHitObject(line));
         }
-        return 0.1f;
     }
 
     float sliderMultiplier = 1.0f;
+    double lastObjectTime = 0.0;
+    files::MappedFile file;
+    std::string unpacked;
     std::vector<HitObject> hitObjectParams;
-    std::vector<TimingPoint> inheritedTimingPoints;
-    std::vector<TimingPoint> uninheritedTimingPoints;
+    TimingTimeline timeline;
     std::vector<Event> events;
-    std::map<std::string, std::string> meta;
+    std::map<std::string_view, std::string_view, std::less<>> meta;
 };
 
 bool LoadOSU(const std::filesystem::path &pathIn, MapInfo &map)
@@ -478,4 +483,14 @@ bool LoadOSU(const std::filesystem::path &pathIn, MapInfo &map)
     return false;
 }
 
+bool LoadOSUHeader(const std::filesystem::path &pathIn, MapHeader &header)
+{
+    OSUMapLoader loader;
+    if (loader.read(pathIn, true)) {
+        loader.readHeader(header);
+        return true;
+    }
+    return false;
+}
+
 }
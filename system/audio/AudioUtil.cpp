@@ -23,8 +23,92 @@
 
 #include "Log.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
 namespace PROJECT_NAMESPACE::audio {
 
+constexpr int MEMORY_IO_BUFFER_SIZE = 32768;
+
+static int ReadMemoryInput(void *opaque, uint8_t *buffer, int size)
+{
+	auto *memory = static_cast<FFmpegMemoryInput *>(opaque);
+	auto remaining = int64_t(memory->data.size()) - memory->position;
+	if (remaining <= 0) {
+		return AVERROR_EOF;
+	}
+	auto count = (int)std::min<int64_t>(size, remaining);
+	std::memcpy(buffer, memory->data.data() + memory->position, count);
+	memory->position += count;
+	return count;
+}
+
+static int64_t SeekMemoryInput(void *opaque, int64_t offset, int whence)
+{
+	auto *memory = static_cast<FFmpegMemoryInput *>(opaque);
+	auto size = int64_t(memory->data.size());
+
+	switch (whence & ~AVSEEK_FORCE) {
+		case AVSEEK_SIZE:
+			return size;
+		case SEEK_SET:
+			break;
+		case SEEK_CUR:
+			offset += memory->position;
+			break;
+		case SEEK_END:
+			offset += size;
+			break;
+		default:
+			return -1;
+	}
+
+	if (offset < 0 || offset > size) {
+		return -1;
+	}
+	memory->position = offset;
+	return offset;
+}
+
+/// Points the context at a file inside an archive, stored members are read straight out of the mapped archive.
+static bool OpenMemoryInput(FFmpegCtx &ctx, const files::ArchivePath &member)
+{
+	auto memory = std::make_shared<FFmpegMemoryInput>();
+
+	memory->archive = files::ZipArchive::Get(member.archive);
+	const auto *entry = memory->archive ? memory->archive->find(member.member) : nullptr;
+	if (!entry) {
+		return false;
+	}
+	if (auto stored = memory->archive->view(*entry)) {
+		memory->data = *stored;
+	} else if (memory->archive->read(*entry, memory->unpacked)) {
+		memory->data = memory->unpacked;
+	} else {
+		return false;
+	}
+
+	auto *buffer = (unsigned char *)av_malloc(MEMORY_IO_BUFFER_SIZE);
+	if (!buffer) {
+		return false;
+	}
+	ctx.io = avio_alloc_context(
+		buffer, MEMORY_IO_BUFFER_SIZE, 0, memory.get(), ReadMemoryInput, nullptr, SeekMemoryInput);
+	if (!ctx.io) {
+		av_free(buffer);
+		return false;
+	}
+
+	ctx.format = avformat_alloc_context();
+	if (!ctx.format) {
+		return false;
+	}
+	ctx.format->pb = ctx.io;
+	ctx.memory = std::move(memory);
+	return true;
+}
+
 FFmpegCtx OpenFFmpegContext(const std::filesystem::path &path)
 {
 	av_log_set_level(AV_LOG_QUIET);
@@ -51,6 +135,13 @@ FFmpegCtx OpenFFmpegContext(const std::filesystem::path &path)
 	const char* ptr = (const char*)string.c_str();
 #endif
 
+	if (auto member = files::SplitArchivePath(path)) {
+		if (!OpenMemoryInput(ctx, *member)) {
+			log::Error("Unable to read ", path, " from its archive");
+			return invalidate();
+		}
+	}
+
 	if ((err = avformat_open_input(&ctx.format, ptr, nullptr, nullptr)) != 0) {
 		return invalidate("Error opening file.");
 	}
@@ -172,6 +263,11 @@ void FreeFFmpegContext(FFmpegCtx &ctx)
 	avformat_free_context(ctx.format);
 	avcodec_free_context(&ctx.codecCtx);
 	av_packet_free(&ctx.packet);
+	if (ctx.io) {
+		av_freep(&ctx.io->buffer);
+		avio_context_free(&ctx.io);
+	}
+	ctx.memory.reset();
 }
 
 
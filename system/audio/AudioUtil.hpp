@@ -25,11 +25,15 @@
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
 
 #include "define.hpp"
 #include "Audio.hpp"
 #include "Log.hpp"
 #include "Math.hpp"
+#include "ZipArchive.hpp"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -39,6 +43,16 @@ extern "C" {
 
 namespace PROJECT_NAMESPACE::audio {
 
+/// A file inside an archive, which FFmpeg reads through a custom IO context.
+struct FFmpegMemoryInput {
+	// Keeps data alive when it points straight into the archive.
+	std::shared_ptr<const files::ZipArchive> archive;
+	// Holds the contents of compressed members.
+	std::string unpacked;
+	std::string_view data;
+	int64_t position{0};
+};
+
 struct FFmpegCtx {
 	bool valid{true};
 	bool eof{false};
@@ -49,6 +63,9 @@ struct FFmpegCtx {
 	AVFrame* frame{nullptr};
 	AVFormatContext *format{nullptr};
 	AVCodecContext* codecCtx{nullptr};
+	// Only set for files read out of archives.
+	AVIOContext* io{nullptr};
+	std::shared_ptr<FFmpegMemoryInput> memory;
 
 	int sampleRate{0};
 };
@@ -22,22 +22,56 @@
 #include "Program.hpp"
 
 #include "Log.hpp"
-#include "State.hpp"
 #include "Error.hpp"
 #include "Tasks.hpp"
 
+// The headless build has no states or settings, it only borrows Exit.
+#ifndef HEADLESS
+#include "State.hpp"
+#include "Settings.hpp"
+#include "Util.hpp"
+
+#include "nameof.hpp"
+#endif
+
 #include <cstdlib>
 
 namespace PROJECT_NAMESPACE::core
 {
 
+#ifndef HEADLESS
+tasks::PoolConfiguration ReadPoolConfiguration(Settings &settings)
+{
+    tasks::PoolConfiguration configuration;
+
+    configuration.threadCount = (unsigned int)settings.addSetting<int>(
+        "setting.tasks.threads", 0, SettingFlags::WRITE_TO_FILE, 0, 256).get();
+    configuration.lowerBackgroundPriority = settings.addSetting<bool>(
+        "setting.tasks.lower_background_priority", true, SettingFlags::WRITE_TO_FILE).get();
+
+    for (size_t i = 0; i < (size_t)tasks::TaskID::COUNT; i++) {
+        auto name = LowerCaseCopy(std::string(NAMEOF_ENUM((tasks::TaskID)i)));
+        if (name.empty()) {
+            continue;
+        }
+        configuration.namedAffinity[i] = settings.addSetting<int>(
+            "setting.tasks.affinity." + name, tasks::NO_AFFINITY, SettingFlags::WRITE_TO_FILE, tasks::NO_AFFINITY, 1023).get();
+    }
+
+    return configuration;
+}
+
 /// Serves as the real entry point to the program, gets called from main.
 void EntryPoint()
 {
     // First initialize all the APIs we rely on.
     error::detail::InstallHandler();
-    tasks::Start();
     log::detail::Init();
+
+    // The pool has to be up before any state gets created, so its settings are read on their own.
+    Settings poolSettings;
+    poolSettings.read(CONFIG_PATH);
+    tasks::Start(ReadPoolConfiguration(poolSettings));
     log::Custom(log::Severity::INF, "TOAST", "Hello world!");
 
     // SDL2, OpenGL and FreeType get initiated by the video module during static initialization.
@@ -53,6 +87,7 @@ void EntryPoint()
     // We're done here...
     Exit(0);
 }
+#endif
 
 void Exit(int code)
 {
@@ -64,6 +99,8 @@ void Exit(int code)
 
 }
 
+// The headless build brings its own entry point, see HeadlessMain.cpp.
+#ifndef HEADLESS
 #if defined(WINDOWS) && defined(RELEASE)
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                     PWSTR pCmdLine, int nCmdShow)
@@ -73,3 +110,4 @@ int main()
 {
     PROJECT_NAMESPACE::core::EntryPoint();
 }
+#endif
@@ -31,9 +31,26 @@
 
 #include "EnumOperators.hpp"
 
+namespace PROJECT_NAMESPACE
+{
+class Settings;
+
+namespace tasks
+{
+struct PoolConfiguration;
+}
+}
+
 namespace PROJECT_NAMESPACE::core
 {
 
+#ifndef HEADLESS
+/// @brief Registers the task pool settings and reads the pool configuration out of them.
+/// Changes only take effect on the next launch.
+/// @param settings The settings to read from.
+tasks::PoolConfiguration ReadPoolConfiguration(Settings &settings);
+#endif
+
 /// @brief Exits the program with the given exit code.
 /// @param code The exit code.
 void Exit(int code);
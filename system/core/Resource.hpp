@@ -33,14 +33,22 @@
 #include <string>
 #include <filesystem>
 #include <cstddef>
+#include <type_traits>
 
 namespace PROJECT_NAMESPACE {
 class Resources;
 
+namespace tasks {
+// Only needed complete where LoadAsync gets instantiated, those places include Co.hpp.
+template<typename T> requires std::is_default_constructible_v<T>
+class Co;
+}
+
 template <typename T> class Resource;
 
 template <typename T> Resource<T> Default();
 template <typename T> Resource<T> Load(const std::filesystem::path&);
+template <typename T> tasks::Co<Resource<T>> LoadAsync(std::filesystem::path);
 template <typename T> Resource<T> Create();
 
 template <typename T>
@@ -134,6 +142,13 @@ Resource<T> Load(const std::filesystem::path&)
 	return {};
 }
 
+/// Coroutine version of Load, specialised by loaders which can await their file reads instead of blocking on them.
+template <typename T>
+tasks::Co<Resource<T>> LoadAsync(std::filesystem::path path)
+{
+	co_return Load<T>(path);
+}
+
 template <typename T>
 Resource<T> Default()
 {
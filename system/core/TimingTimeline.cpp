@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#include "TimingTimeline.hpp"
+
+#include <algorithm>
+
+namespace PROJECT_NAMESPACE {
+
+namespace
+{
+
+/// Index of the last point starting at or before time, the first point for times before all of them.
+template<typename PointT>
+std::size_t FindPoint(const std::vector<PointT> &points, double time)
+{
+    auto it = std::upper_bound(points.begin(), points.end(), time, [](double value, const PointT &point)
+    { return value < point.time; });
+    return it == points.begin() ? 0 : std::size_t(std::distance(points.begin(), it) - 1);
+}
+
+/// Moves index forward to the point active at time, starting over with a binary search when time went backwards.
+template<typename PointT>
+std::size_t AdvancePoint(const std::vector<PointT> &points, std::size_t index, double time)
+{
+    if (index >= points.size() || (index > 0 && time < points[index].time)) {
+        return FindPoint(points, time);
+    }
+    while (index + 1 < points.size() && points[index + 1].time <= time) {
+        index++;
+    }
+    return index;
+}
+
+/// Inserts point after every point at the same time, points are usually added in order so this is an append.
+template<typename PointT>
+void InsertPoint(std::vector<PointT> &points, const PointT &point)
+{
+    if (points.empty() || points.back().time <= point.time) {
+        points.push_back(point);
+        return;
+    }
+    auto it = std::upper_bound(points.begin(), points.end(), point.time, [](double value, const PointT &other)
+    { return value < other.time; });
+    points.insert(it, point);
+}
+
+}
+
+void TimingTimeline::addTimingPoint(const TimingPoint &point)
+{
+    InsertPoint(timingPoints, point);
+}
+
+void TimingTimeline::addVelocityPoint(const VelocityPoint &point)
+{
+    InsertPoint(velocityPoints, point);
+}
+
+void TimingTimeline::clear()
+{
+    timingPoints.clear();
+    velocityPoints.clear();
+}
+
+bool TimingTimeline::empty() const
+{
+    return timingPoints.empty() && velocityPoints.empty();
+}
+
+void TimingTimeline::setDefaultBeatLength(double beatLength)
+{
+    fallback.beatLength = beatLength;
+}
+
+const TimingPoint &TimingTimeline::timingAt(double time) const
+{
+    if (timingPoints.empty()) {
+        return fallback;
+    }
+    return timingPoints[FindPoint(timingPoints, time)];
+}
+
+double TimingTimeline::beatLengthAt(double time) const
+{
+    return timingAt(time).beatLength;
+}
+
+double TimingTimeline::bpmAt(double time) const
+{
+    return 60.0 / beatLengthAt(time);
+}
+
+double TimingTimeline::velocityAt(double time) const
+{
+    if (velocityPoints.empty()) {
+        return 1.0;
+    }
+    return velocityPoints[FindPoint(velocityPoints, time)].multiplier;
+}
+
+double TimingTimeline::beatsAt(double time) const
+{
+    const auto &point = timingAt(time);
+    return (time - point.time) / point.beatLength;
+}
+
+const std::vector<TimingPoint> &TimingTimeline::getTimingPoints() const
+{
+    return timingPoints;
+}
+
+const std::vector<VelocityPoint> &TimingTimeline::getVelocityPoints() const
+{
+    return velocityPoints;
+}
+
+const TimingPoint &TimingTimeline::Cursor::timingAt(const TimingTimeline &timeline, double time)
+{
+    if (timeline.timingPoints.empty()) {
+        return timeline.timingAt(time);
+    }
+    timing = AdvancePoint(timeline.timingPoints, timing, time);
+    return timeline.timingPoints[timing];
+}
+
+double TimingTimeline::Cursor::velocityAt(const TimingTimeline &timeline, double time)
+{
+    if (timeline.velocityPoints.empty()) {
+        return 1.0;
+    }
+    velocity = AdvancePoint(timeline.velocityPoints, velocity, time);
+    return timeline.velocityPoints[velocity].multiplier;
+}
+
+double TimingTimeline::Cursor::beatsAt(const TimingTimeline &timeline, double time)
+{
+    const auto &point = timingAt(timeline, time);
+    return (time - point.time) / point.beatLength;
+}
+
+void TimingTimeline::Cursor::reset()
+{
+    timing = 0;
+    velocity = 0;
+}
+
+}
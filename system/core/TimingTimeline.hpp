@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "define.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+/**
+ * A point at which the tempo of a song changes, the tempo lasts until the next one.
+ */
+struct TimingPoint
+{
+    // Start of the point in seconds.
+    double time = 0.0;
+    // Length of a single beat in seconds.
+    double beatLength = 0.5;
+    // Beats per measure.
+    int meter = 4;
+};
+
+/**
+ * A point at which the scroll or slider velocity of a map changes, independent of the tempo.
+ */
+struct VelocityPoint
+{
+    // Start of the point in seconds.
+    double time = 0.0;
+    // Multiplier of the base velocity.
+    double multiplier = 1.0;
+};
+
+/**
+ * The tempo and velocity changes of a song, kept sorted by time.
+ *
+ * A point applies from its time until the next point, the first point also covers everything before it. Out of
+ * several points at the same time the one added last wins. Lookups are binary searches, code which queries times in
+ * increasing order (loaders walking the hit objects, animations following the song) can keep a Cursor instead, which
+ * only steps forward.
+ */
+class TimingTimeline
+{
+public:
+    /**
+     * Remembers the points found by the last lookup so that the next one, if it's at a later time, only has to look
+     * at the points following them. Holds no reference to the timeline, so it can be kept next to a timeline and
+     * copied along with it.
+     */
+    class Cursor
+    {
+    public:
+        [[nodiscard]] const TimingPoint &timingAt(const TimingTimeline &timeline, double time);
+        [[nodiscard]] double velocityAt(const TimingTimeline &timeline, double time);
+        [[nodiscard]] double beatsAt(const TimingTimeline &timeline, double time);
+
+        void reset();
+
+    private:
+        std::size_t timing = 0;
+        std::size_t velocity = 0;
+    };
+
+    void addTimingPoint(const TimingPoint &point);
+    void addVelocityPoint(const VelocityPoint &point);
+    void clear();
+
+    /**
+     * @param beatLength Beat length used while the timeline has no timing points.
+     */
+    void setDefaultBeatLength(double beatLength);
+
+    [[nodiscard]] bool empty() const;
+
+    /**
+     * @return The tempo at time. Without any timing points this is a point at 0 with the default beat length.
+     */
+    [[nodiscard]] const TimingPoint &timingAt(double time) const;
+    [[nodiscard]] double beatLengthAt(double time) const;
+    [[nodiscard]] double bpmAt(double time) const;
+
+    /**
+     * @return The velocity multiplier at time, 1 if the timeline has no velocity points.
+     */
+    [[nodiscard]] double velocityAt(double time) const;
+
+    /**
+     * @return Beats elapsed since the start of the timing point active at time, the fractional part is how far into
+     * the current beat time is.
+     */
+    [[nodiscard]] double beatsAt(double time) const;
+
+    [[nodiscard]] const std::vector<TimingPoint> &getTimingPoints() const;
+    [[nodiscard]] const std::vector<VelocityPoint> &getVelocityPoints() const;
+
+private:
+    std::vector<TimingPoint> timingPoints;
+    std::vector<VelocityPoint> velocityPoints;
+    // Stands in for the timing point while there are none.
+    TimingPoint fallback;
+};
+
+}
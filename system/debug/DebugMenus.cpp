@@ -6,9 +6,127 @@
 #include "Locale.hpp"
 #include "Tasks.hpp"
 
+#include <algorithm>
+#include <map>
+
 namespace PROJECT_NAMESPACE
 {
 
+static ImU32 GetSpanColor(tasks::SpanKind kind)
+{
+    switch (kind) {
+        case tasks::SpanKind::Execute:
+            return IM_COL32(230, 120, 120, 255);
+        case tasks::SpanKind::QueueWait:
+            return IM_COL32(120, 120, 230, 160);
+        case tasks::SpanKind::Message:
+            return IM_COL32(230, 200, 90, 255);
+        case tasks::SpanKind::NamedIteration:
+            return IM_COL32(120, 200, 120, 255);
+        default:
+            return IM_COL32(200, 200, 200, 255);
+    }
+}
+
+void DrawTaskTrace()
+{
+    static bool frozen = false;
+    static float windowLength = 100.0f;
+    static std::string exportPath = "trace.json";
+    static std::vector<tasks::TraceSpan> spans;
+    static std::vector<tasks::TraceThread> threads;
+
+    bool tracing = tasks::Tracing();
+    if (ImGui::Checkbox("record", &tracing)) {
+        tasks::SetTracing(tracing);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("freeze", &frozen);
+    ImGui::SameLine();
+    if (ImGui::Button("clear")) {
+        tasks::ClearTrace();
+    }
+    ImGui::SliderFloat("window (ms)", &windowLength, 1.0f, 10000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+    ImGui::InputText("##tracepath", &exportPath);
+    ImGui::SameLine();
+    if (ImGui::Button("export")) {
+        tasks::ExportTrace(exportPath);
+    }
+
+    if (!frozen) {
+        spans = tasks::GetTrace();
+        threads = tasks::GetTraceThreads();
+    }
+    if (spans.empty()) {
+        ImGui::Text("no spans recorded");
+        return;
+    }
+
+    // The timeline shows the last windowLength ms before the most recent span ended.
+    auto last = std::max_element(spans.begin(), spans.end(), [](const auto &a, const auto &b)
+    { return a.end < b.end; })->end;
+    auto first = last - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<float, std::milli>(windowLength));
+    auto toMs = [](auto duration)
+    { return std::chrono::duration<float, std::milli>(duration).count(); };
+
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float labelWidth = 120.0f;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 1.0f);
+    const ImVec2 mouse = ImGui::GetMousePos();
+    auto *draw = ImGui::GetWindowDrawList();
+
+    for (const auto &thread : threads) {
+        draw->AddText({origin.x, origin.y + (float)thread.id * rowHeight}, IM_COL32_WHITE, thread.name.c_str());
+    }
+
+    std::map<std::string_view, float> executeTotals;
+    for (const auto &span : spans) {
+        if (span.end < first || span.start > last) {
+            continue;
+        }
+
+        float x0 = origin.x + labelWidth + toMs(std::max(span.start, first) - first) / windowLength * width;
+        float x1 = origin.x + labelWidth + toMs(std::min(span.end, last) - first) / windowLength * width;
+        x1 = std::max(x1, x0 + 1.0f);
+        float y0 = origin.y + (float)span.thread * rowHeight;
+        float y1 = y0 + rowHeight - 1.0f;
+        // Waits go underneath the work itself.
+        if (span.kind == tasks::SpanKind::QueueWait) {
+            y0 += rowHeight * 0.6f;
+        }
+        draw->AddRectFilled({x0, y0}, {x1, y1}, GetSpanColor(span.kind));
+
+        auto duration = toMs(span.end - span.start);
+        if (span.kind == tasks::SpanKind::Execute) {
+            executeTotals[span.name] += duration;
+        }
+        if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+            auto kind = tasks::GetSpanKindName(span.kind);
+            ImGui::SetTooltip("%.*s\n%.*s: %.3f ms", (int)span.name.size(), span.name.data(),
+                              (int)kind.size(), kind.data(), duration);
+        }
+    }
+    ImGui::Dummy({labelWidth + width, (float)threads.size() * rowHeight});
+
+    std::vector<std::pair<std::string_view, float>> totals(executeTotals.begin(), executeTotals.end());
+    std::sort(totals.begin(), totals.end(), [](const auto &a, const auto &b)
+    { return a.second > b.second; });
+    if (ImGui::BeginTable("##tracetotals", 2)) {
+        ImGui::TableSetupColumn("Task");
+        ImGui::TableSetupColumn("Executing (ms)");
+        ImGui::TableHeadersRow();
+        for (const auto &[name, total] : totals) {
+            ImGui::TableNextColumn();
+            ImGui::Text("%.*s", (int)name.size(), name.data());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", total);
+        }
+        ImGui::EndTable();
+    }
+}
+
 void DrawDebugMenu()
 {
     static bool showVersion = false;
@@ -120,6 +238,17 @@ void DrawDebugMenu()
             // ImGui::Text("total: %lu", loaded+remaining);
             // ImGui::Separator();
             ImGui::Text("active tasks: %lu", tasks::GetTaskQueueLength());
+            ImGui::Text(
+                "realtime: %lu, interactive: %lu, background: %lu",
+                tasks::GetTaskQueueLength(tasks::Priority::Realtime),
+                tasks::GetTaskQueueLength(tasks::Priority::Interactive),
+                tasks::GetTaskQueueLength(tasks::Priority::Background)
+            );
+            auto allocations = tasks::GetAllocationStats();
+            ImGui::Text(
+                "task heap allocations: %lu, pooled: %lu, reserved: %lu KiB",
+                allocations.heapAllocations, allocations.pooledAllocations, allocations.bytesReserved / 1024
+            );
             auto infos = tasks::GetThreadStates();
             if (ImGui::BeginTable("##threadinfo", 4)) {
                 for (size_t i = 0; i < infos.size(); i++) {
@@ -155,6 +284,11 @@ void DrawDebugMenu()
             ImGui::EndTabItem();
         }
 
+        if (ImGui::BeginTabItem("ui.main.trace.title"_i18n.c_str())) {
+            DrawTaskTrace();
+            ImGui::EndTabItem();
+        }
+
         ImGui::EndTabBar();
     }
 }
@@ -7,4 +7,7 @@ namespace PROJECT_NAMESPACE
 
 void DrawDebugMenu();
 
+/// Timeline of the task trace, see tasks::SetTracing.
+void DrawTaskTrace();
+
 }
\ No newline at end of file
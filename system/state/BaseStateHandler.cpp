@@ -29,6 +29,8 @@
 #define USER_STATE_INCLUDES
 #include "config.hpp"
 #include "Error.hpp"
+#include "Program.hpp"
+#include "Tasks.hpp"
 
 #include <memory>
 
@@ -52,6 +54,8 @@ BaseStateHandler::StateReturn BaseStateHandler::enter()
     if (!context->settings.read(CONFIG_PATH)) {
         logger(log::Severity::ERR, "Couldn't read the settings!");
     }
+    // Only registered so they show up and get saved, the pool was configured on startup.
+    core::ReadPoolConfiguration(context->settings);
 
     if (context->gfx.init()) {
         if (!context->gfx.initImGui()) {
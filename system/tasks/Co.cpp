@@ -0,0 +1,138 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#include "Co.hpp"
+#include "Log.hpp"
+#include "ZipArchive.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace PROJECT_NAMESPACE::tasks
+{
+
+namespace
+{
+
+struct IoQueue
+{
+	std::mutex mutex;
+	std::condition_variable signal;
+	std::deque<std::function<void()>> requests;
+	std::vector<std::thread> threads;
+	bool run{false};
+};
+
+// Never destroyed, so a missing Stop() doesn't end in joinable threads being destructed.
+IoQueue &GetIoQueue()
+{
+	static auto *queue = new IoQueue;
+	return *queue;
+}
+
+void IoRunner()
+{
+	auto &queue = GetIoQueue();
+	detail::NameTraceThread("io");
+
+	while (true) {
+		std::function<void()> request;
+		{
+			std::unique_lock<std::mutex> lock(queue.mutex);
+			queue.signal.wait(lock, [&queue]()
+			{ return !queue.requests.empty() || !queue.run; });
+			if (queue.requests.empty()) {
+				return;
+			}
+			request = std::move(queue.requests.front());
+			queue.requests.pop_front();
+		}
+		request();
+	}
+}
+
+}
+
+void detail::SubmitIo(std::function<void()> &&request)
+{
+	auto &queue = GetIoQueue();
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.run) {
+			queue.run = true;
+			for (unsigned int i = 0; i < IO_THREAD_COUNT; i++) {
+				queue.threads.emplace_back(IoRunner);
+			}
+		}
+		queue.requests.push_back(std::move(request));
+	}
+	queue.signal.notify_one();
+}
+
+void detail::StopIo()
+{
+	auto &queue = GetIoQueue();
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.run = false;
+		threads.swap(queue.threads);
+	}
+	queue.signal.notify_all();
+
+	// Requests still queued get finished first, their coroutines then simply never resume.
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+std::optional<std::string> ReadFile::Read(const std::filesystem::path &path)
+{
+	if (auto member = files::SplitArchivePath(path)) {
+		std::string contents;
+		if (!files::ReadArchiveMember(*member, contents)) {
+			log::Warning("Failed to read ", path, " from its archive");
+			return {};
+		}
+		return contents;
+	}
+
+	std::ifstream ifs(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!ifs) {
+		log::Warning("Failed to open ", path, " for reading");
+		return {};
+	}
+
+	std::string contents;
+	contents.resize((size_t)ifs.tellg());
+	ifs.seekg(0);
+	ifs.read(contents.data(), (std::streamsize)contents.size());
+	if (!ifs) {
+		log::Warning("Failed to read ", path);
+		return {};
+	}
+	return contents;
+}
+
+}
@@ -0,0 +1,374 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include "Tasks.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace tasks {
+
+/// Threads doing blocking file reads for coroutines, so pool threads never wait on the disk.
+constexpr unsigned int IO_THREAD_COUNT = 2;
+
+template<typename T> requires std::is_default_constructible_v<T>
+class Co;
+
+namespace detail {
+
+template<typename T>
+struct CoroutineHolder;
+
+template<typename T>
+struct CoAwaiter;
+
+/// Runs the blocking request on one of the IO threads, starting them if needed.
+void SubmitIo(std::function<void()> &&request);
+
+void StopIo();
+
+/// Resumes a coroutine on the pool, keeping the task it belongs to alive until then.
+struct ResumeTask
+{
+	bool operator()()
+	{
+		handle.resume();
+		return true;
+	}
+
+	std::coroutine_handle<> handle;
+	std::shared_ptr<BaseTaskHolder> root;
+};
+
+inline void Resume(std::coroutine_handle<> handle, const std::shared_ptr<BaseTaskHolder> &root)
+{
+	auto resumed = MakeSimple(root ? root->scheduling : Scheduling{}, ResumeTask{handle, root});
+
+	// A resumption dropped by the pool stopping never gives the coroutine its result, so its task is stopped instead.
+	if (root) {
+		resumed.onComplete([resumed, root]()
+		{
+			if (!resumed.getResult()) {
+				root->stop();
+				root->runContinuations();
+			}
+		});
+	}
+}
+
+struct CoPromiseBase
+{
+	std::suspend_always initial_suspend() noexcept
+	{ return {}; }
+
+	void unhandled_exception()
+	{ std::terminate(); }
+
+	/// The coroutine awaiting this one, resumed in place once this one returns.
+	std::coroutine_handle<> continuation;
+	/// The task spawned for the outermost coroutine, shared by every coroutine it awaits.
+	std::weak_ptr<BaseTaskHolder> root;
+};
+
+struct FinalAwaiter
+{
+	bool await_ready() noexcept
+	{ return false; }
+
+	template<typename PromiseT>
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> handle) noexcept
+	{
+		auto &promise = handle.promise();
+		if (promise.continuation) {
+			return promise.continuation;
+		}
+		promise.complete();
+		return std::noop_coroutine();
+	}
+
+	void await_resume() noexcept
+	{}
+};
+
+}
+
+/**
+ * A lazily started coroutine producing a T. It is started either by co_awaiting it from another Co,
+ * which runs it in place, or by handing it to Spawn, which runs it on the pool as a task of its own.
+ * Every time it gets suspended it resumes on the pool with the scheduling of the spawned task.
+ */
+template<typename T> requires std::is_default_constructible_v<T>
+class Co
+{
+public:
+	struct promise_type : public detail::CoPromiseBase
+	{
+		Co get_return_object()
+		{ return Co(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+		detail::FinalAwaiter final_suspend() noexcept
+		{ return {}; }
+
+		void return_value(T valueIn)
+		{ value = std::move(valueIn); }
+
+		/// Hands the value over to the spawned task, only reached by the outermost coroutine.
+		void complete()
+		{
+			if (holder) {
+				holder->result = value ? std::move(*value) : T{};
+				holder->done = true;
+				holder->runContinuations();
+			}
+		}
+
+		std::optional<T> value;
+		detail::CoroutineHolder<T> *holder{nullptr};
+	};
+
+	using HandleType = std::coroutine_handle<promise_type>;
+	using ResultType = T;
+
+	Co(Co &&other) noexcept
+		: handle(std::exchange(other.handle, nullptr))
+	{}
+
+	Co &operator=(Co &&other) noexcept
+	{
+		std::swap(handle, other.handle);
+		return *this;
+	}
+
+	Co(const Co &) = delete;
+	Co &operator=(const Co &) = delete;
+
+	~Co()
+	{
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	auto operator co_await() noexcept
+	{ return detail::CoAwaiter<T>{handle}; }
+
+	HandleType getHandle() const
+	{ return handle; }
+
+private:
+	explicit Co(HandleType handleIn)
+		: handle(handleIn)
+	{}
+
+	HandleType handle;
+};
+
+namespace detail {
+
+/// The task a spawned coroutine reports to. It is never queued itself, only the resumptions are.
+template<typename T>
+struct CoroutineHolder : public TaskHolder<T, Co<T>>
+{
+	explicit CoroutineHolder(Co<T> &&coroutine)
+		: TaskHolder<T, Co<T>>(std::move(coroutine))
+	{}
+
+	void stop() override
+	{ done = true; }
+
+	bool isComplete() const override
+	{ return done; }
+
+	std::string_view name() const override
+	{ return NAMEOF_SHORT_TYPE(Co<T>); }
+
+	std::atomic<bool> done{false};
+};
+
+/// Runs the awaited coroutine in place of the awaiting one, which continues once it returns.
+template<typename T>
+struct CoAwaiter
+{
+	bool await_ready() noexcept
+	{ return !handle || handle.done(); }
+
+	template<typename PromiseT>
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> awaiting) noexcept
+	{
+		handle.promise().continuation = awaiting;
+		handle.promise().root = awaiting.promise().root;
+		return handle;
+	}
+
+	T await_resume()
+	{
+		if (!handle) {
+			return T{};
+		}
+		auto &value = handle.promise().value;
+		return value ? std::move(*value) : T{};
+	}
+
+	typename Co<T>::HandleType handle;
+};
+
+struct RescheduleAwaiter
+{
+	bool await_ready() const noexcept
+	{ return false; }
+
+	template<typename PromiseT>
+	void await_suspend(std::coroutine_handle<PromiseT> handle) const
+	{
+		auto root = handle.promise().root.lock();
+		if (root && scheduling) {
+			root->scheduling = *scheduling;
+		}
+		Resume(handle, root);
+	}
+
+	void await_resume() const noexcept
+	{}
+
+	std::optional<Scheduling> scheduling;
+};
+
+/// Awaits a pool task, giving back its result or a default value if it got stopped.
+template<typename HolderT>
+struct ResultAwaiter
+{
+	bool await_ready() const
+	{ return result.isComplete(); }
+
+	template<typename PromiseT>
+	void await_suspend(std::coroutine_handle<PromiseT> handle) const
+	{
+		result.onComplete([handle, root = handle.promise().root.lock()]()
+		{ Resume(handle, root); });
+	}
+
+	auto await_resume() const
+	{
+		using ResultType = typename Result<HolderT>::ResultType;
+		auto value = result.getResult();
+		return value ? std::move(*value) : ResultType{};
+	}
+
+	Result<HolderT> result;
+};
+
+}
+
+/**
+ * Starts a coroutine on the pool.
+ * @return Result which completes once the coroutine returns.
+ */
+template<typename T>
+Result<detail::TaskHolder<T, Co<T>>> Spawn(Co<T> &&coroutine, Scheduling scheduling = {})
+{
+	auto handle = coroutine.getHandle();
+	auto holder = std::allocate_shared<detail::CoroutineHolder<T>>(
+		detail::PoolAllocator<detail::CoroutineHolder<T>>(), std::move(coroutine));
+	holder->scheduling = scheduling;
+	holder->enqueueTime = std::chrono::steady_clock::now();
+
+	if (!handle) {
+		holder->result.emplace();
+		holder->done = true;
+		holder->runContinuations();
+	} else {
+		handle.promise().root = holder;
+		handle.promise().holder = holder.get();
+		detail::Resume(handle, holder);
+	}
+	return Result<detail::TaskHolder<T, Co<T>>>{holder};
+}
+
+template<typename HolderT>
+auto operator co_await(const Result<HolderT> &result)
+{
+	return detail::ResultAwaiter<HolderT>{result};
+}
+
+/// Moves the coroutine over to the pool, optionally switching it to a different lane for good.
+inline detail::RescheduleAwaiter Reschedule(std::optional<Scheduling> scheduling = {})
+{
+	return {scheduling};
+}
+
+/// Reads a whole file, which may be a member of an archive, on an IO thread. Gives back nothing if it couldn't be read.
+class ReadFile
+{
+public:
+	explicit ReadFile(std::filesystem::path pathIn)
+		: path(std::move(pathIn))
+	{}
+
+	bool await_ready() const noexcept
+	{ return false; }
+
+	template<typename PromiseT>
+	void await_suspend(std::coroutine_handle<PromiseT> handle)
+	{
+		detail::SubmitIo([this, handle, root = handle.promise().root.lock()]()
+		{
+			contents = Read(path);
+			detail::Resume(handle, root);
+		});
+	}
+
+	std::optional<std::string> await_resume()
+	{ return std::move(contents); }
+
+	static std::optional<std::string> Read(const std::filesystem::path &path);
+
+private:
+	std::filesystem::path path;
+	std::optional<std::string> contents;
+};
+
+/// Runs the coroutines side by side on the pool, gives back their values in order.
+template<typename T>
+Co<std::vector<T>> All(std::vector<Co<T>> coroutines, Scheduling scheduling = {})
+{
+	std::vector<decltype(Spawn(std::declval<Co<T>>()))> results;
+	results.reserve(coroutines.size());
+	for (auto &coroutine : coroutines) {
+		results.push_back(Spawn(std::move(coroutine), scheduling));
+	}
+	co_return co_await WhenAll(results);
+}
+
+}
+
+}
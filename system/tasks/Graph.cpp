@@ -0,0 +1,127 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+
+#include "Graph.hpp"
+#include "Log.hpp"
+
+#include <queue>
+
+namespace PROJECT_NAMESPACE::tasks
+{
+
+Graph::NodeID Graph::add(std::function<void()> &&work)
+{
+	Node node;
+	node.work = std::move(work);
+	nodes.push_back(std::move(node));
+	return nodes.size() - 1;
+}
+
+void Graph::precede(NodeID before, NodeID after)
+{
+	if (before >= nodes.size() || after >= nodes.size()) {
+		log::Warning("Tried to link task graph nodes", before, "and", after, "out of", nodes.size());
+		return;
+	}
+	nodes[before].successors.push_back(after);
+	nodes[after].dependencies++;
+}
+
+Graph::CompletionResult Graph::run(Scheduling scheduling) const
+{
+	if (hasCycle()) {
+		log::Error("Task graph contains a cycle, refusing to run it.");
+		return {};
+	}
+
+	using InnerHolderT = detail::SimpleTaskHolder<NodeTask>;
+
+	std::vector<std::shared_ptr<InnerHolderT>> holders;
+	std::vector<NodeResult> results;
+	holders.reserve(nodes.size());
+	results.reserve(nodes.size());
+
+	for (const auto &node : nodes) {
+		auto holder = std::allocate_shared<InnerHolderT>(
+			detail::PoolAllocator<InnerHolderT>(), NodeTask{node.work}, std::tuple<>());
+		holder->scheduling = scheduling;
+		holders.push_back(holder);
+		results.emplace_back(holder);
+	}
+
+	auto completion = WhenAll(results);
+
+	std::vector<std::function<void()>> arrivals;
+	arrivals.reserve(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++) {
+		arrivals.emplace_back(detail::MakeArrival(holders[i], nodes[i].dependencies + 1));
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++) {
+		for (auto successor : nodes[i].successors) {
+			results[i].onComplete(std::function<void()>(arrivals[successor]));
+		}
+	}
+
+	// Releases the extra count held by every node, which queues up the roots.
+	for (auto &arrive : arrivals) {
+		arrive();
+	}
+
+	return completion;
+}
+
+size_t Graph::size() const
+{
+	return nodes.size();
+}
+
+bool Graph::hasCycle() const
+{
+	std::vector<size_t> dependencies;
+	dependencies.reserve(nodes.size());
+	std::queue<NodeID> ready;
+
+	for (NodeID i = 0; i < nodes.size(); i++) {
+		dependencies.push_back(nodes[i].dependencies);
+		if (nodes[i].dependencies == 0) {
+			ready.push(i);
+		}
+	}
+
+	size_t visited = 0;
+	while (!ready.empty()) {
+		auto current = ready.front();
+		ready.pop();
+		visited++;
+
+		for (auto successor : nodes[current].successors) {
+			if (--dependencies[successor] == 0) {
+				ready.push(successor);
+			}
+		}
+	}
+
+	return visited != nodes.size();
+}
+
+}
@@ -0,0 +1,84 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include "Result.hpp"
+#include "JoinTask.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace PROJECT_NAMESPACE::tasks
+{
+
+/**
+ * A set of jobs with ordering constraints between them. Once run, every job is queued as soon as
+ * all of its dependencies have completed, so independent branches execute in parallel on the pool.
+ * A graph can be run any number of times.
+ */
+class Graph
+{
+public:
+	using NodeID = size_t;
+
+	struct NodeTask
+	{
+		bool operator()()
+		{
+			work();
+			return true;
+		}
+
+		std::function<void()> work;
+	};
+
+	using NodeResult = Result<detail::TaskHolder<bool, NodeTask>>;
+	using CompletionResult = decltype(WhenAll(std::declval<const std::vector<NodeResult> &>()));
+
+	/// Adds a job to the graph.
+	NodeID add(std::function<void()> &&work);
+
+	/// Makes the job after wait for the job before to complete.
+	void precede(NodeID before, NodeID after);
+
+	/// Schedules the graph on the pool, the result completes once every job has.
+	/// Returns an empty result if the graph contains a cycle.
+	CompletionResult run(Scheduling scheduling = {}) const;
+
+	[[nodiscard]] size_t size() const;
+
+private:
+	struct Node
+	{
+		std::function<void()> work;
+		std::vector<NodeID> successors;
+		size_t dependencies{0};
+	};
+
+	[[nodiscard]] bool hasCycle() const;
+
+	std::vector<Node> nodes;
+};
+
+}
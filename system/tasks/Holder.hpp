@@ -24,11 +24,18 @@
 #include "define.hpp"
 
 #include <memory>
-#include <queue>
 #include <mutex>
+#include <optional>
 #include <thread>
+#include <chrono>
+#include <functional>
+#include <vector>
 
 #include "Message.hpp"
+#include "MessageRing.hpp"
+#include "Trace.hpp"
+
+#include "nameof.hpp"
 
 namespace PROJECT_NAMESPACE {
 
@@ -37,24 +44,95 @@ namespace tasks
 
 constexpr unsigned int MAX_TASK_MESSAGE_QUEUE_LENGTH = 128;
 
+/// Priority lanes of the task pool. A lane is only served once all lanes above it are empty.
+enum class Priority
+{
+	Realtime,       // Work the current frame is waiting on, e.g. audio refills.
+	Interactive,    // Work the user is waiting on, e.g. loading the selected map.
+	Background,     // Everything else, e.g. library scans.
+	COUNT
+};
+
+constexpr size_t LANE_COUNT = (size_t)Priority::COUNT;
+
+constexpr auto NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+
+/// Where a task goes in the pool. Within a lane, tasks run earliest deadline first,
+/// tasks without a deadline run after those with one in the order they were queued.
+struct Scheduling
+{
+	Priority priority{Priority::Interactive};
+	std::chrono::steady_clock::time_point deadline{NO_DEADLINE};
+};
+
 namespace detail
 {
 
 struct BaseMessageHolder;
 
+struct BaseTaskHolder;
+
+void Enqueue(const std::shared_ptr<BaseTaskHolder> &);
+
 struct BaseTaskHolder
 {
 	inline virtual bool invoke()
 	{ return false; };
 
-	inline virtual void receive(const std::shared_ptr<BaseMessageHolder> &)
-	{};
+	/// Takes over the reference to the message held by the caller.
+	inline virtual void receive(BaseMessageHolder *msg)
+	{
+		msg->complete = true;
+		msg->release();
+	};
 
 	inline virtual void stop()
 	{};
 
 	inline virtual bool isComplete() const
 	{ return true; };
+
+	/// What the task shows up as in traces.
+	inline virtual std::string_view name() const
+	{ return "task"; };
+
+	/// Schedules a callback to run on the thread that completes this task,
+	/// or right away if the task has already completed.
+	void continueWith(std::function<void()> &&continuation)
+	{
+		{
+			std::lock_guard<std::mutex> guard(continuationMutex);
+			if (!continued) {
+				continuations.push_back(std::move(continuation));
+				return;
+			}
+		}
+		continuation();
+	}
+
+	/// Runs the scheduled continuations, gets called once the task completes.
+	void runContinuations()
+	{
+		std::vector<std::function<void()>> pending;
+		{
+			std::lock_guard<std::mutex> guard(continuationMutex);
+			if (continued) {
+				return;
+			}
+			continued = true;
+			pending.swap(continuations);
+		}
+		for (auto &continuation : pending) {
+			continuation();
+		}
+	}
+
+	std::chrono::steady_clock::time_point enqueueTime;
+	Scheduling scheduling;
+
+	std::mutex continuationMutex;
+	std::vector<std::function<void()>> continuations;
+	bool continued{false};
 };
 
 template<typename ResultT, typename TaskT> requires std::is_default_constructible_v<ResultT>
@@ -67,7 +145,7 @@ struct TaskHolder: public BaseTaskHolder
 		: task(std::move(taskIn))
 	{}
 
-	std::unique_ptr<ResultType> result;
+	std::optional<ResultType> result;
 	TaskType task;
 };
 
@@ -81,15 +159,25 @@ struct WrappedTaskHolder: public TaskHolder<std::invoke_result_t<TaskT, TaskArgs
 	typedef std::invoke_result_t<TaskT, TaskArgsT...> TaskResultType;
 
 	WrappedTaskHolder(TaskType &&taskIn, TaskArgumentsType &&argsIn)
-		: Parent(std::move(taskIn)), outerMessageQueue(&messageQueues[0]),
-		  innerMessageQueue(&messageQueues[1]), args(argsIn)
+		: Parent(std::move(taskIn)), args(argsIn)
 	{}
 
+	~WrappedTaskHolder()
+	{
+		if (auto ring = messages.load()) {
+			BaseMessageHolder *msg;
+			while (ring->pop(msg)) {
+				msg->complete = true;
+				msg->release();
+			}
+			delete ring;
+		}
+	}
+
 	bool invoke() override
 	{
-		executionId = std::this_thread::get_id();
 		if (!this->result) {
-			this->result = std::make_unique<TaskResultType>();
+			this->result.emplace();
 		}
 
 		if (!this->isComplete()) {
@@ -98,45 +186,49 @@ struct WrappedTaskHolder: public TaskHolder<std::invoke_result_t<TaskT, TaskArgs
 
 		this->onIteration();
 
-		{
-			std::lock_guard<std::mutex> guard(messageQueueMutex);
-			if (outerMessageQueue == &messageQueues[0]) {
-				innerMessageQueue = &messageQueues[0];
-				outerMessageQueue = &messageQueues[1];
-			} else {
-				outerMessageQueue = &messageQueues[0];
-				innerMessageQueue = &messageQueues[1];
+		// Messages sent by the handlers themselves are picked up in the same pass.
+		if (auto ring = messages.load(std::memory_order_acquire)) {
+			BaseMessageHolder *msg;
+			while (ring->pop(msg)) {
+				{
+					TraceScope scope(SpanKind::Message, msg->name());
+					msg->receiveSelf(this);
+				}
+				msg->release();
 			}
 		}
 
-		auto &queue = *innerMessageQueue;
-		while (!queue.empty()) {
-			auto &msg = queue.front();
-			msg->receiveSelf(this);
-			queue.pop();
-		}
-
 		return this->isComplete();
 	}
 
-	void receive(const std::shared_ptr<BaseMessageHolder> &msg) override
+	void receive(BaseMessageHolder *msg) override
 	{
-		std::lock_guard<std::mutex> guard(messageQueueMutex);
-		if (std::this_thread::get_id() == executionId) {
-			innerMessageQueue->push(msg);
-		} else if (outerMessageQueue->size() <= MAX_TASK_MESSAGE_QUEUE_LENGTH) {
-			outerMessageQueue->push(msg);
+		auto ring = messages.load(std::memory_order_acquire);
+		if (!ring) {
+			// Most tasks never receive a message, so the ring only gets created on first use.
+			auto created = new MessageRingType;
+			if (messages.compare_exchange_strong(ring, created, std::memory_order_acq_rel)) {
+				ring = created;
+			} else {
+				delete created;
+			}
+		}
+
+		// Dropped messages still complete, so nobody waits on a reply forever.
+		if (!ring->push(msg)) {
+			msg->complete = true;
+			msg->release();
 		}
 	}
 
+	std::string_view name() const override
+	{ return NAMEOF_SHORT_TYPE(TaskType); }
+
 	virtual void onIteration()
 	{}
 
-	std::queue<std::shared_ptr<BaseMessageHolder>> messageQueues[2];
-	std::mutex messageQueueMutex;
-	std::queue<std::shared_ptr<BaseMessageHolder>> *outerMessageQueue;
-	std::queue<std::shared_ptr<BaseMessageHolder>> *innerMessageQueue;
-	std::thread::id executionId;
+	using MessageRingType = MessageRing<BaseMessageHolder *, MAX_TASK_MESSAGE_QUEUE_LENGTH>;
+	std::atomic<MessageRingType *> messages{nullptr};
 
 	TaskArgumentsType args;
 };
@@ -0,0 +1,126 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include "Holder.hpp"
+#include "Result.hpp"
+#include "SimpleTask.hpp"
+#include "Pool.hpp"
+
+#include <atomic>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace tasks {
+
+namespace detail {
+
+template<typename ... ResultTs>
+struct JoinTask {
+	std::tuple<typename ResultTs::ResultType...> operator()() {
+		return std::apply([](const auto &... parts)
+		{
+			return std::tuple(parts.getResult().value_or(typename std::remove_cvref_t<decltype(parts)>::ResultType{})...);
+		}, results);
+	}
+
+	std::tuple<ResultTs...> results;
+};
+
+template<typename ResultT>
+struct VectorJoinTask {
+	std::vector<typename ResultT::ResultType> operator()() {
+		std::vector<typename ResultT::ResultType> values;
+		values.reserve(results.size());
+		for (const auto &part : results) {
+			values.push_back(part.getResult().value_or(typename ResultT::ResultType{}));
+		}
+		return values;
+	}
+
+	std::vector<ResultT> results;
+};
+
+/// Returns a callback which enqueues the holder on its count-th invocation.
+template<typename HolderT>
+auto MakeArrival(const std::shared_ptr<HolderT> &holder, size_t count)
+{
+	auto remaining = std::make_shared<std::atomic<size_t>>(count);
+	return [holder, remaining]()
+	{
+		if (--(*remaining) == 0) {
+			Enqueue(holder);
+		}
+	};
+}
+
+}
+
+/**
+ * Creates a task which completes once all of the given tasks have, producing a tuple of their results.
+ * Tasks which were stopped before producing a result contribute a default constructed value.
+ */
+template<typename ... HolderTs>
+auto WhenAll(const Result<HolderTs> &... results)
+{
+	using TaskT = detail::JoinTask<Result<HolderTs>...>;
+	using InnerHolderT = detail::SimpleTaskHolder<TaskT>;
+	using HolderT = detail::TaskHolder<std::invoke_result_t<TaskT>, TaskT>;
+
+	auto holder = std::allocate_shared<InnerHolderT>(
+		detail::PoolAllocator<InnerHolderT>(), TaskT{{results...}}, std::tuple<>());
+	auto arrive = detail::MakeArrival(holder, sizeof...(HolderTs) + 1);
+	(results.onComplete(arrive), ...);
+	arrive();
+	return Result<HolderT>{holder};
+}
+
+/**
+ * Creates a task which completes once all of the given tasks have, producing a vector of their results.
+ * Tasks which were stopped before producing a result contribute a default constructed value.
+ */
+template<typename HolderT>
+auto WhenAll(const std::vector<Result<HolderT>> &results)
+{
+	using TaskT = detail::VectorJoinTask<Result<HolderT>>;
+	using InnerHolderT = detail::SimpleTaskHolder<TaskT>;
+	using JoinHolderT = detail::TaskHolder<std::invoke_result_t<TaskT>, TaskT>;
+
+	auto holder = std::allocate_shared<InnerHolderT>(
+		detail::PoolAllocator<InnerHolderT>(), TaskT{results}, std::tuple<>());
+	auto arrive = detail::MakeArrival(holder, results.size() + 1);
+
+	for (const auto &result : results) {
+		result.onComplete(arrive);
+	}
+	arrive();
+	return Result<JoinHolderT>{holder};
+}
+
+}
+
+}
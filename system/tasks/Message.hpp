@@ -26,6 +26,13 @@
 #include <type_traits>
 #include <memory>
 #include <atomic>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "Pool.hpp"
+
+#include "nameof.hpp"
 
 namespace PROJECT_NAMESPACE {
 
@@ -37,10 +44,90 @@ namespace detail
 
 struct BaseTaskHolder;
 
+/// Messages are reference counted by hand so that queueing one only moves a pointer around.
+/// The sender and the queue each hold a reference, the last one to let go deletes it.
 struct BaseMessageHolder
 {
+	virtual ~BaseMessageHolder() = default;
+
+	static void *operator new(size_t size)
+	{ return PoolAllocate(size); }
+
+	static void operator delete(void *block, size_t size)
+	{ PoolDeallocate(block, size); }
+
 	inline virtual void receiveSelf(BaseTaskHolder *)
 	{}
+
+	inline virtual std::string_view name() const
+	{ return "message"; }
+
+	void acquire()
+	{
+		references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release()
+	{
+		if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			delete this;
+		}
+	}
+
+	std::atomic<bool> complete{false};
+	std::atomic<unsigned int> references{1};
+};
+
+/// Owning handle to a message, see BaseMessageHolder.
+template<typename MessageHolderT>
+class MessageRef
+{
+public:
+	MessageRef() = default;
+
+	/// Adopts the reference the message was created with.
+	explicit MessageRef(MessageHolderT *adopted)
+		: held(adopted)
+	{}
+
+	MessageRef(const MessageRef &other)
+		: held(other.held)
+	{
+		if (held) {
+			held->acquire();
+		}
+	}
+
+	MessageRef(MessageRef &&other) noexcept
+		: held(other.held)
+	{
+		other.held = nullptr;
+	}
+
+	MessageRef &operator=(MessageRef other) noexcept
+	{
+		std::swap(held, other.held);
+		return *this;
+	}
+
+	~MessageRef()
+	{
+		if (held) {
+			held->release();
+		}
+	}
+
+	MessageHolderT *operator->() const
+	{ return held; }
+
+	MessageHolderT *get() const
+	{ return held; }
+
+	explicit operator bool() const
+	{ return held != nullptr; }
+
+private:
+	MessageHolderT *held{nullptr};
 };
 
 template<typename HeldValueT, typename HolderT>
@@ -57,8 +144,11 @@ struct MessageHolder: public BaseMessageHolder
 
 	bool isComplete()
 	{
+		if (complete) {
+			return true;
+		}
 		if (auto ptr = executor.lock()) {
-			return (ptr->isComplete() || complete);
+			return ptr->isComplete();
 		} else {
 			return true;
 		}
@@ -66,16 +156,16 @@ struct MessageHolder: public BaseMessageHolder
 
 	inline void receiveSelf(BaseTaskHolder *holder) override
 	{
-		result = std::make_unique<ResultType>();
-
 		auto cast = (HolderType *)holder;
-		*result = cast->task.receive(message);
+		result = cast->task.receive(message);
 		complete = true;
 	}
 
-	std::atomic<bool> complete{false};
+	std::string_view name() const override
+	{ return NAMEOF_SHORT_TYPE(HeldValueType); }
+
 	HeldValueType message;
-	std::unique_ptr<ResultType> result;
+	std::optional<ResultType> result;
 	std::weak_ptr<HolderT> executor;
 };
 }
@@ -0,0 +1,114 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace PROJECT_NAMESPACE::tasks::detail
+{
+
+/**
+ * Bounded lock-free queue with any number of producers and a single consumer.
+ * Every cell carries a sequence number telling whether it is free to write or ready to read,
+ * so producers only contend on claiming a position and never on each other's data.
+ * @tparam T The stored type, meant to be a pointer or another trivially copyable handle.
+ * @tparam Capacity Number of cells, has to be a power of two.
+ */
+template<typename T, size_t Capacity>
+class MessageRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	MessageRing()
+	{
+		for (size_t i = 0; i < Capacity; i++) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MessageRing(const MessageRing &) = delete;
+	MessageRing &operator=(const MessageRing &) = delete;
+
+	/// Appends a value, may be called from any thread. Returns false if the ring is full.
+	bool push(const T &value)
+	{
+		Cell *cell;
+		size_t position = writePosition.load(std::memory_order_relaxed);
+
+		for (;;) {
+			cell = &cells[position & MASK];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			auto difference = (intptr_t)sequence - (intptr_t)position;
+
+			if (difference == 0) {
+				if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = writePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->value = value;
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Takes the oldest value, may only be called from one thread at a time. Returns false if empty.
+	bool pop(T &out)
+	{
+		auto &cell = cells[readPosition & MASK];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+		if ((intptr_t)sequence - (intptr_t)(readPosition + 1) < 0) {
+			return false;
+		}
+
+		out = cell.value;
+		cell.sequence.store(readPosition + Capacity, std::memory_order_release);
+		readPosition++;
+		return true;
+	}
+
+private:
+	static constexpr size_t MASK = Capacity - 1;
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value{};
+	};
+
+	std::array<Cell, Capacity> cells;
+	alignas(64) std::atomic<size_t> writePosition{0};
+	alignas(64) size_t readPosition{0};
+};
+
+}
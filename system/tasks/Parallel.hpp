@@ -0,0 +1,239 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include "Tasks.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace tasks {
+
+/// Pass as the grain to let the range be split into about PARALLEL_CHUNKS_PER_THREAD chunks per pool thread.
+constexpr size_t AUTO_GRAIN = 0;
+constexpr size_t PARALLEL_CHUNKS_PER_THREAD = 4;
+
+namespace detail {
+
+/// Shared between the caller of ParallelFor and its helper tasks. The context pointer is only
+/// dereferenced while a chunk is claimed, the caller outlives every claimed chunk.
+struct ParallelState {
+	std::atomic<size_t> nextChunk{0};
+	std::atomic<size_t> doneChunks{0};
+	size_t chunkCount{0};
+	void *context{nullptr};
+	void (*runChunk)(void *, size_t){nullptr};
+
+	/// Claims and runs chunks until none are left.
+	void drain()
+	{
+		size_t chunk;
+		while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount) {
+			runChunk(context, chunk);
+			doneChunks.fetch_add(1, std::memory_order_release);
+		}
+	}
+};
+
+inline size_t PickGrain(size_t count, size_t grain)
+{
+	if (grain != AUTO_GRAIN) {
+		return grain;
+	}
+	size_t target = std::max<size_t>(GetTaskThreadCount(), 1) * PARALLEL_CHUNKS_PER_THREAD;
+	return std::max<size_t>((count + target - 1) / target, 1);
+}
+
+/**
+ * Runs chunk(i) for i in [0, chunkCount) on the pool and the calling thread, returns once all have finished.
+ * The caller takes part in the work, so this is safe to call from inside a pool task.
+ */
+template<typename ChunkT>
+void RunChunks(size_t chunkCount, Scheduling scheduling, ChunkT &chunk)
+{
+	if (chunkCount == 0) {
+		return;
+	}
+	if (chunkCount == 1 || GetTaskThreadCount() == 0) {
+		for (size_t i = 0; i < chunkCount; i++) {
+			chunk(i);
+		}
+		return;
+	}
+
+	auto state = std::allocate_shared<ParallelState>(PoolAllocator<ParallelState>());
+	state->chunkCount = chunkCount;
+	state->context = &chunk;
+	state->runChunk = [](void *context, size_t i)
+	{ (*static_cast<ChunkT *>(context))(i); };
+
+	size_t helpers = std::min(chunkCount - 1, GetTaskThreadCount());
+	for (size_t i = 0; i < helpers; i++) {
+		MakeSimple(scheduling, [state]()
+		{
+			state->drain();
+			return true;
+		});
+	}
+
+	state->drain();
+	while (state->doneChunks.load(std::memory_order_acquire) < chunkCount) {
+		std::this_thread::yield();
+	}
+}
+
+}
+
+/**
+ * Calls fn(i) for every i in [begin, end), split into chunks of grain indices spread over the task pool.
+ * Blocks until every call has returned.
+ * @param grain Indices per chunk, AUTO_GRAIN sizes the chunks from the pool size.
+ * @param scheduling Lane and deadline the helper tasks are enqueued with.
+ */
+template<typename IndexT, typename FunctionT>
+void ParallelFor(IndexT begin, IndexT end, size_t grain, FunctionT &&fn, Scheduling scheduling = {})
+{
+	if (end <= begin) {
+		return;
+	}
+	size_t count = size_t(end - begin);
+	grain = detail::PickGrain(count, grain);
+	size_t chunks = (count + grain - 1) / grain;
+
+	auto chunk = [&](size_t i)
+	{
+		IndexT first = begin + IndexT(i * grain);
+		IndexT last = begin + IndexT(std::min(count, (i + 1) * grain));
+		for (IndexT index = first; index < last; ++index) {
+			fn(index);
+		}
+	};
+	detail::RunChunks(chunks, scheduling, chunk);
+}
+
+template<typename IndexT, typename FunctionT>
+void ParallelFor(IndexT begin, IndexT end, FunctionT &&fn)
+{
+	ParallelFor(begin, end, AUTO_GRAIN, std::forward<FunctionT>(fn));
+}
+
+/// Parallel std::transform over random access ranges, returns the end of the output range.
+template<typename InputIt, typename OutputIt, typename FunctionT>
+OutputIt ParallelTransform(InputIt first, InputIt last, OutputIt out, FunctionT &&fn, size_t grain = AUTO_GRAIN)
+{
+	auto count = std::distance(first, last);
+	ParallelFor(decltype(count)(0), count, grain, [&](auto i)
+	{
+		out[i] = fn(first[i]);
+	});
+	return out + count;
+}
+
+/**
+ * Parallel std::reduce over a random access range. Every chunk is folded on its own starting from its first
+ * element and the partial sums are then folded into init in order, so op has to be associative.
+ */
+template<typename InputIt, typename T, typename OperationT>
+T ParallelReduce(InputIt first, InputIt last, T init, OperationT &&op, size_t grain = AUTO_GRAIN)
+{
+	size_t count = size_t(std::distance(first, last));
+	if (count == 0) {
+		return init;
+	}
+	grain = detail::PickGrain(count, grain);
+	size_t chunks = (count + grain - 1) / grain;
+
+	std::vector<T> partials(chunks);
+	auto chunk = [&](size_t i)
+	{
+		auto it = first + i * grain;
+		auto end = first + std::min(count, (i + 1) * grain);
+		T sum = *it;
+		for (++it; it != end; ++it) {
+			sum = op(std::move(sum), *it);
+		}
+		partials[i] = std::move(sum);
+	};
+	detail::RunChunks(chunks, Scheduling{}, chunk);
+
+	for (auto &partial : partials) {
+		init = op(std::move(init), std::move(partial));
+	}
+	return init;
+}
+
+template<typename InputIt, typename T>
+T ParallelReduce(InputIt first, InputIt last, T init)
+{
+	return ParallelReduce(first, last, std::move(init), std::plus<>());
+}
+
+/// Sorts chunks of a random access range in parallel and merges them pairwise. Not stable.
+template<typename RandomIt, typename CompareT>
+void ParallelSort(RandomIt first, RandomIt last, CompareT comp, size_t grain = AUTO_GRAIN)
+{
+	size_t count = size_t(std::distance(first, last));
+	grain = detail::PickGrain(count, grain);
+	if (count <= grain) {
+		std::sort(first, last, comp);
+		return;
+	}
+	size_t chunks = (count + grain - 1) / grain;
+
+	auto sortChunk = [&](size_t i)
+	{
+		std::sort(first + i * grain, first + std::min(count, (i + 1) * grain), comp);
+	};
+	detail::RunChunks(chunks, Scheduling{}, sortChunk);
+
+	for (size_t width = grain; width < count; width *= 2) {
+		size_t merges = (count + 2 * width - 1) / (2 * width);
+		auto mergeChunk = [&](size_t i)
+		{
+			size_t begin = i * 2 * width;
+			size_t middle = std::min(count, begin + width);
+			size_t end = std::min(count, begin + 2 * width);
+			if (middle < end) {
+				std::inplace_merge(first + begin, first + middle, first + end, comp);
+			}
+		};
+		detail::RunChunks(merges, Scheduling{}, mergeChunk);
+	}
+}
+
+template<typename RandomIt>
+void ParallelSort(RandomIt first, RandomIt last)
+{
+	ParallelSort(first, last, std::less<>());
+}
+
+}
+
+}
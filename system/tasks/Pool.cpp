@@ -0,0 +1,199 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+
+#include "Pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+namespace PROJECT_NAMESPACE::tasks
+{
+
+namespace
+{
+
+constexpr size_t MIN_BLOCK_SHIFT = 4;
+constexpr size_t CLASS_COUNT = std::bit_width(detail::MAX_POOLED_BLOCK) - MIN_BLOCK_SHIFT;
+constexpr size_t SLAB_SIZE = 16 * 1024;
+constexpr size_t CACHE_LIMIT = 128;
+constexpr size_t TRANSFER_BATCH = CACHE_LIMIT / 2;
+
+struct FreeBlock
+{
+	FreeBlock *next;
+};
+
+struct SharedList
+{
+	std::mutex mutex;
+	FreeBlock *head{nullptr};
+	size_t count{0};
+};
+
+// Kept trivially destructible on purpose: pool memory may still be released from static
+// destructors after a thread's cache would have been torn down. Blocks left in the cache
+// of an exiting thread are simply not reused.
+struct ThreadCache
+{
+	FreeBlock *head{nullptr};
+	size_t count{0};
+};
+
+struct Counters
+{
+	std::atomic<size_t> heapAllocations{0};
+	std::atomic<size_t> pooledAllocations{0};
+	std::atomic<size_t> bytesReserved{0};
+};
+
+// Never destroyed, for the same reason as ThreadCache.
+std::array<SharedList, CLASS_COUNT> &SharedLists()
+{
+	static auto *lists = new std::array<SharedList, CLASS_COUNT>;
+	return *lists;
+}
+
+Counters &GetCounters()
+{
+	static auto *counters = new Counters;
+	return *counters;
+}
+
+thread_local std::array<ThreadCache, CLASS_COUNT> Caches{};
+
+size_t SizeClass(size_t bytes)
+{
+	if (bytes <= (1 << MIN_BLOCK_SHIFT)) {
+		return 0;
+	}
+	return std::bit_width(bytes - 1) - MIN_BLOCK_SHIFT;
+}
+
+void Refill(ThreadCache &cache, size_t sizeClass)
+{
+	auto &shared = SharedLists()[sizeClass];
+	{
+		std::lock_guard<std::mutex> lock(shared.mutex);
+		while (shared.head && cache.count < TRANSFER_BATCH) {
+			auto block = shared.head;
+			shared.head = block->next;
+			shared.count--;
+			block->next = cache.head;
+			cache.head = block;
+			cache.count++;
+		}
+	}
+
+	if (cache.head) {
+		return;
+	}
+
+	const size_t blockSize = size_t(1) << (sizeClass + MIN_BLOCK_SHIFT);
+	const size_t slabSize = std::max(SLAB_SIZE, blockSize);
+	auto slab = static_cast<std::byte *>(::operator new(slabSize));
+
+	auto &counters = GetCounters();
+	counters.heapAllocations++;
+	counters.bytesReserved += slabSize;
+
+	for (size_t offset = 0; offset + blockSize <= slabSize; offset += blockSize) {
+		auto block = reinterpret_cast<FreeBlock *>(slab + offset);
+		block->next = cache.head;
+		cache.head = block;
+		cache.count++;
+	}
+}
+
+void Spill(ThreadCache &cache, size_t sizeClass)
+{
+	auto &shared = SharedLists()[sizeClass];
+	std::lock_guard<std::mutex> lock(shared.mutex);
+	while (cache.head && cache.count > CACHE_LIMIT - TRANSFER_BATCH) {
+		auto block = cache.head;
+		cache.head = block->next;
+		cache.count--;
+		block->next = shared.head;
+		shared.head = block;
+		shared.count++;
+	}
+}
+
+}
+
+void *detail::PoolAllocate(size_t bytes)
+{
+	auto &counters = GetCounters();
+	if (bytes > MAX_POOLED_BLOCK) {
+		counters.heapAllocations++;
+		return ::operator new(bytes);
+	}
+
+	auto sizeClass = SizeClass(bytes);
+	auto &cache = Caches[sizeClass];
+	if (!cache.head) {
+		Refill(cache, sizeClass);
+	}
+
+	auto block = cache.head;
+	cache.head = block->next;
+	cache.count--;
+	counters.pooledAllocations++;
+	return block;
+}
+
+void detail::PoolDeallocate(void *block, size_t bytes)
+{
+	if (!block) {
+		return;
+	}
+
+	if (bytes > MAX_POOLED_BLOCK) {
+		::operator delete(block);
+		return;
+	}
+
+	auto sizeClass = SizeClass(bytes);
+	auto &cache = Caches[sizeClass];
+	auto freed = static_cast<FreeBlock *>(block);
+	freed->next = cache.head;
+	cache.head = freed;
+	cache.count++;
+
+	if (cache.count > CACHE_LIMIT) {
+		Spill(cache, sizeClass);
+	}
+}
+
+AllocationStats GetAllocationStats()
+{
+	auto &counters = GetCounters();
+	return {
+		.heapAllocations = counters.heapAllocations,
+		.pooledAllocations = counters.pooledAllocations,
+		.bytesReserved = counters.bytesReserved
+	};
+}
+
+}
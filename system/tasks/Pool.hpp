@@ -0,0 +1,93 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include <cstddef>
+#include <new>
+
+namespace PROJECT_NAMESPACE::tasks
+{
+
+/// Heap traffic of the task system's block pools.
+struct AllocationStats
+{
+	size_t heapAllocations{0};      // Slabs and oversized blocks requested from the heap.
+	size_t pooledAllocations{0};    // Blocks handed out by the pools.
+	size_t bytesReserved{0};        // Bytes held in slabs, these are never given back.
+};
+
+AllocationStats GetAllocationStats();
+
+namespace detail
+{
+
+/**
+ * Hands out blocks from power-of-two size classes. Every thread keeps a small cache of free blocks
+ * per class, overflowing into and refilling from a shared list, and new slabs are only requested
+ * from the heap once both run dry. Requests above MAX_POOLED_BLOCK go straight to the heap.
+ */
+void *PoolAllocate(size_t bytes);
+
+void PoolDeallocate(void *block, size_t bytes);
+
+constexpr size_t MAX_POOLED_BLOCK = 2048;
+
+/// Standard allocator on top of the block pools, for containers and std::allocate_shared.
+template<typename T>
+struct PoolAllocator
+{
+	using value_type = T;
+
+	PoolAllocator() noexcept = default;
+
+	template<typename U>
+	PoolAllocator(const PoolAllocator<U> &) noexcept
+	{}
+
+	T *allocate(size_t count)
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t)) {
+			return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t{alignof(T)}));
+		} else {
+			return static_cast<T *>(PoolAllocate(count * sizeof(T)));
+		}
+	}
+
+	void deallocate(T *pointer, size_t count) noexcept
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t)) {
+			::operator delete(pointer, std::align_val_t{alignof(T)});
+		} else {
+			PoolDeallocate(pointer, count * sizeof(T));
+		}
+	}
+
+	template<typename U>
+	bool operator==(const PoolAllocator<U> &) const noexcept
+	{ return true; }
+};
+
+}
+
+}
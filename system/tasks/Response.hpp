@@ -28,6 +28,8 @@
 #include <optional>
 #include <thread>
 
+#include "Message.hpp"
+
 namespace PROJECT_NAMESPACE {
 
 namespace tasks {
@@ -37,7 +39,7 @@ class Response {
 	typedef std::remove_cvref_t<MessageT> MessageType;
 	typedef typename MessageType::ResultType ReplyType;
 public:
-	explicit Response(std::shared_ptr<MessageType> originIn) : origin(originIn) {}
+	explicit Response(detail::MessageRef<MessageType> originIn) : origin(std::move(originIn)) {}
 
 	bool isComplete() {
 		return origin->isComplete();
@@ -45,13 +47,10 @@ public:
 
 	std::optional<ReplyType> getReply() {
 		if (!isComplete()) {
-			return false;
+			return {};
 		}
 
-		if (bool(origin->result)) {
-			return *(origin->result);
-		}
-		return false;
+		return origin->result;
 	}
 
 	ReplyType waitResult() {
@@ -59,14 +58,14 @@ public:
 			std::this_thread::sleep_for(std::chrono::microseconds(100));
 		}
 
-		if (bool(origin->result)) {
+		if (origin->result) {
 			return *(origin->result);
 		}
 		return ReplyType{};
 	}
 
 private:
-	std::shared_ptr<MessageType> origin;
+	detail::MessageRef<MessageType> origin;
 };
 
 }
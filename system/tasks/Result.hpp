@@ -25,10 +25,14 @@
 
 #include "Message.hpp"
 #include "Response.hpp"
+#include "SimpleTask.hpp"
 
 #include <memory>
 #include <type_traits>
 #include <optional>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 namespace PROJECT_NAMESPACE {
 
@@ -36,9 +40,10 @@ namespace tasks {
 
 template<typename TaskHolderT>
 class Result {
+public:
 	typedef std::remove_cvref_t<TaskHolderT> HolderType;
 	typedef typename HolderType::ResultType ResultType;
-public:
+
 	Result() = default;
 	explicit Result(std::shared_ptr<HolderType> originIn) : origin(originIn) {}
 
@@ -54,7 +59,7 @@ public:
 			return {};
 		}
 
-		if (!isComplete()) {
+		if (!isComplete() || !origin->result) {
 			return {};
 		}
 		auto&& copy = *origin->result;
@@ -68,9 +73,85 @@ public:
 
 		while (!isComplete()) {}
 
+		if (!origin->result) {
+			return {};
+		}
+		return *origin->result;
+	}
+
+	/**
+	 * Same as waitResult, but the calling thread sleeps until the task completes instead of spinning.
+	 * Meant for long waits, the wake up takes longer than noticing the completion while spinning.
+	 */
+	[[nodiscard]] ResultType blockResult() const {
+		if (!origin) {
+			return {};
+		}
+
+		struct Signal {
+			std::mutex mutex;
+			std::condition_variable completed;
+			bool done{false};
+		};
+		auto signal = std::make_shared<Signal>();
+		onComplete([signal]() {
+			{
+				std::lock_guard<std::mutex> lock(signal->mutex);
+				signal->done = true;
+			}
+			signal->completed.notify_all();
+		});
+
+		std::unique_lock<std::mutex> lock(signal->mutex);
+		signal->completed.wait(lock, [&signal]() { return signal->done; });
+
+		if (!origin->result) {
+			return {};
+		}
 		return *origin->result;
 	}
 
+	/**
+	 * Runs a callback on the thread which completes the task, or right away if it is already complete.
+	 * The callback should be short, anything heavier belongs in then().
+	 * @param callback The callback.
+	 */
+	void onComplete(std::function<void()> &&callback) const {
+		if (!origin) {
+			callback();
+			return;
+		}
+		origin->continueWith(std::move(callback));
+	}
+
+	/**
+	 * Schedules a follow-up task which gets the result of this one once it completes.
+	 * The follow-up inherits the scheduling of this task. If this task gets stopped before
+	 * producing a result, the follow-up is stopped as well.
+	 * @param task The follow-up, invocable with the result of this task.
+	 * @return Result of the follow-up task.
+	 */
+	template<typename TaskT>
+	auto then(TaskT &&task) const {
+		using InnerHolderT = detail::SimpleTaskHolder<TaskT, ResultType>;
+		using NextHolderT = detail::TaskHolder<std::invoke_result_t<TaskT, ResultType>, TaskT>;
+
+		auto next = std::allocate_shared<InnerHolderT>(
+			detail::PoolAllocator<InnerHolderT>(), std::forward<TaskT>(task), std::tuple<ResultType>());
+		onComplete([previous = origin.get(), next]()
+		{
+			if (previous && previous->result) {
+				std::get<0>(next->args) = *previous->result;
+				next->scheduling = previous->scheduling;
+				detail::Enqueue(next);
+			} else {
+				next->stop();
+				next->runContinuations();
+			}
+		});
+		return Result<NextHolderT>{next};
+	}
+
 	[[nodiscard]] bool isValid() const {
 		return bool(origin);
 	}
@@ -80,15 +161,22 @@ public:
 		using MessageHolderType = detail::MessageHolder<MessageT, HolderType>;
 		using ReturnType = Response<MessageHolderType>;
 
-		auto wrapped = std::make_shared<MessageHolderType>(msg, origin);
-		ReturnType returnValue{wrapped};
-		origin->receive(std::reinterpret_pointer_cast<detail::BaseMessageHolder>(wrapped));
+		auto wrapped = new MessageHolderType(msg, origin);
+		wrapped->acquire();
+		ReturnType returnValue{detail::MessageRef<MessageHolderType>(wrapped)};
+
+		if (origin) {
+			origin->receive(wrapped);
+		} else {
+			wrapped->complete = true;
+			wrapped->release();
+		}
 		return returnValue;
 	}
 
 	template<typename MessageT>
 	auto message(const MessageT &msg) {
-		return message(std::forward(msg));
+		return message(MessageT(msg));
 	}
 
 private:
@@ -21,18 +21,41 @@
 //=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
 
 #include "Tasks.hpp"
-#include "Math.hpp"
+#include "Co.hpp"
 #include "Log.hpp"
 
+#include "nameof.hpp"
+
 #include <queue>
+#include <deque>
 #include <thread>
+#include <condition_variable>
+#include <bit>
 #include <memory>
 #include <algorithm>
 #include <array>
 
+#ifdef WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#elif LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
 namespace PROJECT_NAMESPACE::tasks
 {
 
+/// Niceness of pool threads running at a lower priority.
+constexpr int BACKGROUND_THREAD_NICENESS = 5;
+
 struct ThreadHolder
 {
 	std::thread theThread;
@@ -41,6 +64,22 @@ struct ThreadHolder
 	std::atomic<bool> paused{true};
 	std::shared_ptr<detail::BaseTaskHolder> task{nullptr};
 
+	// Named task threads park here until PutNamed hands them a task. Also guards task, which
+	// other threads look at while the owner swaps it.
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+
+	std::array<std::atomic<size_t>, LATENCY_HISTOGRAM_BUCKETS> latency{};
+
+	// Work queues of a pool thread, one per priority lane. Every lane is ordered by
+	// deadline, tasks without one keep their submission order at the back. Both the
+	// owner and stealing threads take from the front. Unused by named task threads.
+	using QueueType = std::deque<std::shared_ptr<detail::BaseTaskHolder>,
+		detail::PoolAllocator<std::shared_ptr<detail::BaseTaskHolder>>>;
+	std::array<QueueType, LANE_COUNT> queues;
+	std::mutex queueMutex;
+	size_t index{0};
+
 	ThreadHolder() = default;
 	void stop();
 
@@ -51,48 +90,255 @@ static std::vector<ThreadHolder> Threads;
 
 static std::array<ThreadHolder, (size_t)TaskID::COUNT> NamedTasks;
 
-static std::mutex TaskQueueMutex;
+// Guards the pool itself and holds tasks enqueued before the pool was started.
+static std::mutex PoolMutex;
 
-static std::queue<std::shared_ptr<detail::BaseTaskHolder>> TaskQueue;
+static std::queue<std::shared_ptr<detail::BaseTaskHolder>> PendingTasks;
 
-void TaskRunner(std::reference_wrapper<ThreadHolder> wrappedSelf)
+static std::atomic<bool> PoolRunning{false};
+
+static std::atomic<size_t> NextThread{0};
+
+static thread_local ThreadHolder *CurrentThread = nullptr;
+
+// Idle pool threads park on WakeSignal, the ones reserved for foreground work on
+// ReservedWakeSignal. QueuedTasks counts the tasks sitting in each lane of the pool
+// queues and is only changed while holding the matching queue mutex.
+static std::mutex WakeMutex;
+
+static std::condition_variable WakeSignal;
+
+static std::condition_variable ReservedWakeSignal;
+
+static std::array<std::atomic<long>, LANE_COUNT> QueuedTasks{};
+
+static std::atomic<int> SleepingThreads{0};
+
+static PoolConfiguration Configuration;
+
+static void PinCurrentThread(int core)
 {
-	auto &self = wrappedSelf.get();
+#ifdef WINDOWS
+	if (core < 0 || core >= 64 || !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core)) {
+		log::Warning("Failed to pin thread to core ", core);
+	}
+#elif LINUX
+	if (core < 0 || core >= CPU_SETSIZE) {
+		log::Warning("Failed to pin thread to core ", core);
+		return;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		log::Warning("Failed to pin thread to core ", core);
+	}
+#endif
+}
 
-	using Clock = std::chrono::high_resolution_clock;
+static void LowerCurrentThreadPriority()
+{
+#ifdef WINDOWS
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif LINUX
+	// On Linux the niceness is per thread when given the thread ID.
+	setpriority(PRIO_PROCESS, (id_t)gettid(), BACKGROUND_THREAD_NICENESS);
+#endif
+}
 
-	int sleepJumpValue = 100;
-	const int maxSleepTime = 1000;
+static size_t ReservedThreadCount()
+{
+	return std::min<size_t>(FOREGROUND_RESERVED_THREAD_COUNT, Threads.empty() ? 0 : Threads.size() - 1);
+}
 
-	std::chrono::time_point<Clock> lastExecTP = Clock::now();
+/// Reserved threads never pick up background work, so a long scan can't starve the foreground.
+static bool MayRun(const ThreadHolder &self, size_t lane)
+{
+	return lane != (size_t)Priority::Background || self.index >= ReservedThreadCount();
+}
 
-	while (self.run) {
-		if (self.paused) {
-			auto timeSinceLastExec = Clock::now() - lastExecTP;
-			auto us =
-				(int) std::chrono::duration_cast<std::chrono::milliseconds>(timeSinceLastExec).count();
+static bool HasWork(const ThreadHolder &self)
+{
+	for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+		if (QueuedTasks[lane] > 0 && MayRun(self, lane)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void Push(ThreadHolder &thread, std::shared_ptr<detail::BaseTaskHolder> task)
+{
+	auto lane = (size_t)task->scheduling.priority;
+	{
+		std::lock_guard<std::mutex> lock(thread.queueMutex);
+		auto &queue = thread.queues[lane];
+
+		const auto deadline = task->scheduling.deadline;
+		if (deadline == NO_DEADLINE) {
+			queue.push_back(std::move(task));
+		} else {
+			auto position = std::upper_bound(queue.begin(), queue.end(), deadline,
+				[](const auto &value, const auto &queued)
+				{ return value < queued->scheduling.deadline; });
+			queue.insert(position, std::move(task));
+		}
+		QueuedTasks[lane]++;
+	}
 
-			int sleepTime = us / sleepJumpValue;
-			sleepTime *= sleepJumpValue;
-			sleepTime = math::Min(sleepTime, maxSleepTime);
+	if (SleepingThreads > 0) {
+		{ std::lock_guard<std::mutex> lock(WakeMutex); }
+		WakeSignal.notify_one();
+		if (lane != (size_t)Priority::Background) {
+			ReservedWakeSignal.notify_one();
+		}
+	}
+}
 
-			if (sleepTime > 0) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
-			}
+static std::shared_ptr<detail::BaseTaskHolder> PopFront(ThreadHolder &thread, size_t lane)
+{
+	std::lock_guard<std::mutex> lock(thread.queueMutex);
+	auto &queue = thread.queues[lane];
+	if (queue.empty()) {
+		return nullptr;
+	}
+	auto task = std::move(queue.front());
+	queue.pop_front();
+	QueuedTasks[lane]--;
+	return task;
+}
 
+/// Takes the most urgent task available, looking at the thread's own queue before
+/// stealing from the other pool threads, one lane at a time.
+static std::shared_ptr<detail::BaseTaskHolder> Take(ThreadHolder &self)
+{
+	const auto count = Threads.size();
+	for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+		if (QueuedTasks[lane] <= 0 || !MayRun(self, lane)) {
 			continue;
 		}
 
-		if (bool(self.task)) {
-			self.executing = true;
-			while (!self.task->isComplete() && self.run) {
-				self.task->invoke();
+		for (size_t i = 0; i < count; i++) {
+			if (auto task = PopFront(Threads[(self.index + i) % count], lane)) {
+				return task;
 			}
-			self.task = nullptr;
 		}
-		self.executing = false;
+	}
+	return nullptr;
+}
+
+static std::shared_ptr<detail::BaseTaskHolder> CurrentTask(ThreadHolder &thread)
+{
+	std::lock_guard<std::mutex> lock(thread.wakeMutex);
+	return thread.task;
+}
+
+static void SetTask(ThreadHolder &thread, std::shared_ptr<detail::BaseTaskHolder> task)
+{
+	std::lock_guard<std::mutex> lock(thread.wakeMutex);
+	thread.task = std::move(task);
+}
+
+static void Execute(ThreadHolder &self, SpanKind kind)
+{
+	if (bool(self.task)) {
+		self.executing = true;
+		while (!self.task->isComplete() && self.run) {
+			detail::TraceScope scope(kind, self.task->name());
+			self.task->invoke();
+		}
+		// A task cut short by the pool stopping still has to let its followers know.
+		if (!self.task->isComplete()) {
+			self.task->stop();
+		}
+		self.task->runContinuations();
+		SetTask(self, nullptr);
+	}
+	self.executing = false;
+}
+
+static void WaitForWork(ThreadHolder &self)
+{
+	auto &signal = self.index < ReservedThreadCount() ? ReservedWakeSignal : WakeSignal;
+
+	std::unique_lock<std::mutex> lock(WakeMutex);
+	SleepingThreads++;
+	signal.wait(lock, [&self]()
+	{ return HasWork(self) || !self.run; });
+	SleepingThreads--;
+}
+
+static void RecordLatency(ThreadHolder &self, const detail::BaseTaskHolder &task)
+{
+	auto now = std::chrono::steady_clock::now();
+	auto waited = now - task.enqueueTime;
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+
+	size_t bucket = us > 0 ? std::bit_width((unsigned long long)us) : 0;
+	bucket = std::min<size_t>(bucket, LATENCY_HISTOGRAM_BUCKETS - 1);
+	self.latency[bucket]++;
+
+	if (Tracing()) {
+		detail::RecordSpan(SpanKind::QueueWait, task.name(), task.enqueueTime, now);
+	}
+}
+
+/// Runs a named task thread, which executes whatever task was handed to it by PutNamed.
+void TaskRunner(std::reference_wrapper<ThreadHolder> wrappedSelf)
+{
+	auto &self = wrappedSelf.get();
+	auto id = (TaskID)(&self - NamedTasks.data());
+	auto name = NAMEOF_ENUM(id);
+	detail::NameTraceThread(name.empty() ? "named " + std::to_string((int)id) : std::string(name));
+
+	auto core = Configuration.namedAffinity[(size_t)id];
+	if (core != NO_AFFINITY) {
+		PinCurrentThread(core);
+	}
+
+	while (self.run) {
+		{
+			std::unique_lock<std::mutex> lock(self.wakeMutex);
+			self.wake.wait(lock, [&self]()
+			{ return !self.paused || !self.run; });
+			// taken while still holding the lock, a PutNamed after this point wakes the next iteration
+			self.paused = true;
+		}
+
+		if (bool(self.task)) {
+			RecordLatency(self, *self.task);
+		}
+		Execute(self, SpanKind::NamedIteration);
+	}
+	log::Debug("Stopping");
+}
+
+/// Runs a pool thread. Work is taken from the thread's own queues first and stolen from
+/// the other pool threads once those run dry, so no outside dispatching is needed.
+void PoolRunner(std::reference_wrapper<ThreadHolder> wrappedSelf)
+{
+	auto &self = wrappedSelf.get();
+	CurrentThread = &self;
+	detail::NameTraceThread("pool " + std::to_string(self.index));
+
+	// Threads reserved for the foreground keep their priority, the others mostly end up on
+	// background work and shouldn't take time away from the game.
+	if (Configuration.lowerBackgroundPriority && self.index >= ReservedThreadCount()) {
+		LowerCurrentThreadPriority();
+	}
+
+	while (self.run) {
+		auto next = Take(self);
+		if (!next) {
+			WaitForWork(self);
+			continue;
+		}
+
+		RecordLatency(self, *next);
+		SetTask(self, std::move(next));
+		self.paused = false;
+		Execute(self, SpanKind::Execute);
 		self.paused = true;
-		lastExecTP = Clock::now();
 	}
 	log::Debug("Stopping");
 }
@@ -103,10 +349,17 @@ ThreadHolder::ThreadHolder(const ThreadHolder &)
 
 void ThreadHolder::stop()
 {
-	if (task) {
-		task->stop();
+	if (auto current = CurrentTask(*this)) {
+		current->stop();
 	}
 	run = false;
+
+	{ std::lock_guard<std::mutex> lock(wakeMutex); }
+	wake.notify_all();
+	{ std::lock_guard<std::mutex> lock(WakeMutex); }
+	WakeSignal.notify_all();
+	ReservedWakeSignal.notify_all();
+
 	if (theThread.joinable()) {
 		theThread.join();
 	}
@@ -114,8 +367,24 @@ void ThreadHolder::stop()
 
 void detail::Enqueue(const std::shared_ptr<BaseTaskHolder> &newTask)
 {
-	std::lock_guard<std::mutex> lock(TaskQueueMutex);
-	TaskQueue.push(newTask);
+	newTask->enqueueTime = std::chrono::steady_clock::now();
+
+	// Tasks spawned from inside the pool stay on the spawning thread, everything
+	// else gets spread across the pool and rebalanced by stealing.
+	if (CurrentThread && CurrentThread->run) {
+		Push(*CurrentThread, newTask);
+		return;
+	}
+
+	if (!PoolRunning) {
+		std::lock_guard<std::mutex> lock(PoolMutex);
+		if (!PoolRunning) {
+			PendingTasks.push(newTask);
+			return;
+		}
+	}
+
+	Push(Threads[NextThread++ % Threads.size()], newTask);
 }
 
 void detail::PutNamed(unsigned int id, const std::shared_ptr<detail::BaseTaskHolder> &ptr)
@@ -124,7 +393,9 @@ void detail::PutNamed(unsigned int id, const std::shared_ptr<detail::BaseTaskHol
 
 	// If the thread is already doing something, stop that task first.
 	if (thread.executing) {
-		thread.task->stop();
+		if (auto current = CurrentTask(thread)) {
+			current->stop();
+		}
 	}
 
 	if (std::this_thread::get_id() == thread.theThread.get_id()) {
@@ -136,80 +407,136 @@ void detail::PutNamed(unsigned int id, const std::shared_ptr<detail::BaseTaskHol
 
 	// The new task.
 	if (bool(ptr)) {
-		thread.task = ptr;
-		thread.paused = false;
+		ptr->enqueueTime = std::chrono::steady_clock::now();
+		SetTask(thread, ptr);
+
+		// Named task threads only get started once they have something to run.
+		{
+			std::lock_guard<std::mutex> lock(PoolMutex);
+			if (!thread.theThread.joinable() && PoolRunning) {
+				thread.theThread = std::thread(TaskRunner, std::ref(thread));
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(thread.wakeMutex);
+			thread.paused = false;
+		}
+		thread.wake.notify_one();
 	}
 }
 
 std::shared_ptr<detail::BaseTaskHolder> detail::GetNamed(unsigned int id)
 {
-	return NamedTasks[id % NamedTasks.size()].task;
+	return CurrentTask(NamedTasks[id % NamedTasks.size()]);
 }
 
 void Stop()
 {
-	std::lock_guard<std::mutex> lock(TaskQueueMutex);
-	log::Info("Stopping all threads");
-	while (!TaskQueue.empty()) {
-		TaskQueue.pop();
+	std::vector<std::shared_ptr<detail::BaseTaskHolder>> dropped;
+	{
+		std::lock_guard<std::mutex> lock(PoolMutex);
+		log::Info("Stopping all threads");
+		PoolRunning = false;
+		while (!PendingTasks.empty()) {
+			dropped.push_back(std::move(PendingTasks.front()));
+			PendingTasks.pop();
+		}
 	}
 
 	for (auto &thread : Threads) {
 		thread.stop();
+		std::lock_guard<std::mutex> queueLock(thread.queueMutex);
+		for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+			QueuedTasks[lane] -= (long)thread.queues[lane].size();
+			for (auto &task : thread.queues[lane]) {
+				dropped.push_back(std::move(task));
+			}
+			thread.queues[lane].clear();
+		}
 	}
 	for (auto &thread : NamedTasks) {thread.stop();	}
+	detail::StopIo();
+
+	// Tasks which never got to run are stopped so whatever waits on them completes. Their
+	// continuations may queue more work, which ends up pending and gets dropped the same way.
+	while (!dropped.empty()) {
+		for (auto &task : dropped) {
+			task->stop();
+			task->runContinuations();
+		}
+		dropped.clear();
+
+		std::lock_guard<std::mutex> lock(PoolMutex);
+		while (!PendingTasks.empty()) {
+			dropped.push_back(std::move(PendingTasks.front()));
+			PendingTasks.pop();
+		}
+	}
 }
 
-void Start()
+unsigned int GetDefaultTaskThreadCount()
 {
-	std::lock_guard<std::mutex> lock(TaskQueueMutex);
-	Threads.resize(BASE_TASK_THREAD_COUNT);
+	auto cores = std::thread::hardware_concurrency();
+	if (cores == 0) {
+		return BASE_TASK_THREAD_COUNT;
+	}
+	return cores > UNPOOLED_CORE_COUNT ? cores - UNPOOLED_CORE_COUNT : 1;
+}
 
-    int taskThreads = 0, persistentThreads = 0;
+void Start(const PoolConfiguration &configuration)
+{
+	std::lock_guard<std::mutex> lock(PoolMutex);
+	Configuration = configuration;
+	Threads.resize(configuration.threadCount != 0 ? configuration.threadCount : GetDefaultTaskThreadCount());
 
-	for (auto &thread : Threads) {
-        thread.theThread = std::thread(TaskRunner, std::ref(thread));
-        taskThreads++;
+	for (size_t i = 0; i < Threads.size(); i++) {
+		Threads[i].index = i;
 	}
 
-	for (auto &thread : NamedTasks) {
-		thread.theThread = std::thread(TaskRunner, std::ref(thread));
-        persistentThreads++;
+	for (size_t i = 0; !PendingTasks.empty(); i++) {
+		Push(Threads[i % Threads.size()], std::move(PendingTasks.front()));
+		PendingTasks.pop();
 	}
+	PoolRunning = true;
 
-	log::Info("Started ", taskThreads, " task threads and ", persistentThreads, " persistent threads.");
-}
+	for (auto &thread : Threads) {
+        thread.theThread = std::thread(PoolRunner, std::ref(thread));
+	}
 
-int Update()
-{
-	int newTasksQueued = 0;
-	for (auto &info : Threads) {
-		if (!info.executing && info.paused) {
-			std::lock_guard<std::mutex> lock(TaskQueueMutex);
-			if (!TaskQueue.empty()) {
-				info.task = TaskQueue.front();
-				info.paused = false;
-				TaskQueue.pop();
-				newTasksQueued++;
-			}
+	// Named tasks handed over before the pool was started.
+	for (auto &thread : NamedTasks) {
+		if (thread.task && !thread.paused) {
+			thread.theThread = std::thread(TaskRunner, std::ref(thread));
 		}
 	}
 
-	return newTasksQueued;
+	log::Info("Started ", Threads.size(), " task threads on ", std::thread::hardware_concurrency(), " cores.");
 }
 
 bool Running()
 {
 	return std::any_of(NamedTasks.begin(), NamedTasks.end(), [](auto &info) -> bool
 	{
-		return info.executing || bool(info.task);
+		return info.executing || bool(CurrentTask(info));
 	});
 }
 
 size_t GetTaskQueueLength()
 {
-    std::lock_guard<std::mutex> lock(TaskQueueMutex);
-    return TaskQueue.size();
+    size_t length = 0;
+    {
+        std::lock_guard<std::mutex> lock(PoolMutex);
+        length += PendingTasks.size();
+    }
+    for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+        length += GetTaskQueueLength((Priority)lane);
+    }
+    return length;
+}
+
+size_t GetTaskQueueLength(Priority lane)
+{
+    return (size_t)std::max<long>(QueuedTasks[(size_t)lane], 0);
 }
 size_t GetTaskThreadCount()
 {
@@ -220,12 +547,16 @@ std::vector<ThreadInfo> GetThreadStates()
 {
     std::vector<ThreadInfo> infos;
 
-    for (const auto& thread : Threads) {
+    for (auto& thread : Threads) {
         ThreadInfo inf{
             .id = thread.theThread.get_id(),
-            .taskPtr = thread.task.get()
+            .taskPtr = CurrentTask(thread).get()
         };
 
+        for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+            inf.latency[i] = thread.latency[i];
+        }
+
         if (!thread.run) {
             inf.state = ThreadState::Dead;
         } else {
@@ -25,6 +25,7 @@
 #include "define.hpp"
 
 #include <memory>
+#include <array>
 
 #include "NamedTask.hpp"
 #include "Holder.hpp"
@@ -33,6 +34,10 @@
 #include "SimpleTask.hpp"
 #include "PersistentTask.hpp"
 #include "CountedTask.hpp"
+#include "Pool.hpp"
+#include "JoinTask.hpp"
+#include "Graph.hpp"
+#include "Trace.hpp"
 
 #define USER_PERSISTENT_TASKS_INCLUDES
 #include "config.hpp"
@@ -44,18 +49,50 @@ enum class ThreadState {
     Running, Inactive, Sleeping, Dead
 };
 
+constexpr unsigned int LATENCY_HISTOGRAM_BUCKETS = 20;
+
+/// Counts of enqueue-to-start latencies. Bucket 0 holds tasks started within 1us, bucket i
+/// tasks started within [2^(i-1), 2^i) us and the last bucket everything slower.
+using LatencyHistogram = std::array<size_t, LATENCY_HISTOGRAM_BUCKETS>;
+
 struct ThreadInfo {
     std::thread::id id;
     ThreadState state{ThreadState::Sleeping};
     void* taskPtr{nullptr};
+    LatencyHistogram latency{};
 };
 
-constexpr unsigned int BASE_TASK_THREAD_COUNT = 16;
+/// Pool size used when the core count can't be determined.
+constexpr unsigned int BASE_TASK_THREAD_COUNT = 4;
 
-namespace detail
+/// Cores left over for the main thread and the game task when sizing the pool.
+constexpr unsigned int UNPOOLED_CORE_COUNT = 2;
+
+constexpr int NO_AFFINITY = -1;
+
+struct PoolConfiguration
 {
-void Enqueue(const std::shared_ptr<detail::BaseTaskHolder> &);
+	/// Pool threads to start, 0 sizes the pool from the core count.
+	unsigned int threadCount{0};
+	/// Core each named task's thread gets pinned to, NO_AFFINITY leaves it to the OS.
+	std::array<int, (size_t)TaskID::COUNT> namedAffinity{makeNoAffinity()};
+	/// Runs the pool threads which may take background work at a lower OS priority.
+	bool lowerBackgroundPriority{true};
+
+private:
+	static constexpr std::array<int, (size_t)TaskID::COUNT> makeNoAffinity()
+	{
+		std::array<int, (size_t)TaskID::COUNT> cores{};
+		cores.fill(NO_AFFINITY);
+		return cores;
+	}
+};
+
+/// Pool threads which only ever run realtime and interactive tasks.
+constexpr unsigned int FOREGROUND_RESERVED_THREAD_COUNT = 2;
 
+namespace detail
+{
 void PutNamed(unsigned int id, const std::shared_ptr<detail::BaseTaskHolder> &);
 
 std::shared_ptr<detail::BaseTaskHolder> GetNamed(unsigned int id);
@@ -63,52 +100,78 @@ std::shared_ptr<detail::BaseTaskHolder> GetNamed(unsigned int id);
 
 bool Running();
 
-int Update();
+/// Pool size derived from the core count of the machine.
+unsigned int GetDefaultTaskThreadCount();
 
-void Start();
+void Start(const PoolConfiguration &configuration = {});
 
 void Stop();
 
 size_t GetTaskQueueLength();
+size_t GetTaskQueueLength(Priority lane);
 size_t GetTaskThreadCount();
 std::vector<ThreadInfo> GetThreadStates();
 
 template<typename TaskT, typename ... TaskArgsT>
-auto MakeSimple(TaskT &&task, TaskArgsT &&... args)
+auto MakeSimple(Scheduling scheduling, TaskT &&task, TaskArgsT &&... args)
 {
 	using InnerHolderT = detail::SimpleTaskHolder<TaskT, TaskArgsT...>;
 	using HolderT = detail::TaskHolder<std::invoke_result_t<TaskT, TaskArgsT...>, TaskT>;
 	using ReturnT = Result<HolderT>;
 
-	auto holder = std::make_shared<InnerHolderT>(std::forward<TaskT>(task), std::tuple(args...));
+	auto holder = std::allocate_shared<InnerHolderT>(
+		detail::PoolAllocator<InnerHolderT>(), std::forward<TaskT>(task), std::tuple(args...));
+	holder->scheduling = scheduling;
 	detail::Enqueue(holder);
 	return ReturnT{holder};
 }
 
 template<typename TaskT, typename ... TaskArgsT>
-auto MakePersistent(TaskT &&task, TaskArgsT &&... args)
+auto MakeSimple(TaskT &&task, TaskArgsT &&... args)
+{
+	return MakeSimple(Scheduling{}, std::forward<TaskT>(task), std::forward<TaskArgsT>(args)...);
+}
+
+template<typename TaskT, typename ... TaskArgsT>
+auto MakePersistent(Scheduling scheduling, TaskT &&task, TaskArgsT &&... args)
 {
 	using InnerHolderT = detail::PersistentTaskHolder<TaskT, TaskArgsT...>;
 	using HolderT = detail::TaskHolder<std::invoke_result_t<TaskT, TaskArgsT...>, TaskT>;
 	using ReturnT = Result<HolderT>;
 
-	auto holder = std::make_shared<InnerHolderT>(std::forward<TaskT>(task), std::tuple(args...));
+	auto holder = std::allocate_shared<InnerHolderT>(
+		detail::PoolAllocator<InnerHolderT>(), std::forward<TaskT>(task), std::tuple(args...));
+	holder->scheduling = scheduling;
 	detail::Enqueue(holder);
 	return ReturnT{holder};
 }
 
 template<typename TaskT, typename ... TaskArgsT>
-auto MakeCounted(int runTarget, TaskT &&task, TaskArgsT &&... args)
+auto MakePersistent(TaskT &&task, TaskArgsT &&... args)
+{
+	return MakePersistent(Scheduling{}, std::forward<TaskT>(task), std::forward<TaskArgsT>(args)...);
+}
+
+template<typename TaskT, typename ... TaskArgsT>
+auto MakeCounted(Scheduling scheduling, int runTarget, TaskT &&task, TaskArgsT &&... args)
 {
 	using InnerHolderT = detail::CountedTaskHolder<TaskT, TaskArgsT...>;
 	using HolderT = detail::TaskHolder<std::invoke_result_t<TaskT, TaskArgsT...>, TaskT>;
 	using ReturnT = Result<HolderT>;
 
-	auto holder = std::make_shared<InnerHolderT>(runTarget, std::forward<TaskT>(task), std::tuple(args...));
+	auto holder = std::allocate_shared<InnerHolderT>(
+		detail::PoolAllocator<InnerHolderT>(), runTarget, std::forward<TaskT>(task), std::tuple(args...));
+	holder->scheduling = scheduling;
 	detail::Enqueue(holder);
 	return ReturnT{holder};
 }
 
+template<typename TaskT, typename ... TaskArgsT>
+auto MakeCounted(int runTarget, TaskT &&task, TaskArgsT &&... args)
+{
+	return MakeCounted(Scheduling{}, runTarget, std::forward<TaskT>(task), std::forward<TaskArgsT>(args)...);
+}
+
 template<TaskID ID>
 auto GetNamed()
 {
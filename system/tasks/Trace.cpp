@@ -0,0 +1,241 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#include "Trace.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace PROJECT_NAMESPACE::tasks
+{
+
+std::atomic<bool> detail::TracingEnabled{false};
+
+namespace
+{
+
+// Only ever locked by its own thread while recording, readers lock it to take a snapshot.
+struct TraceBuffer
+{
+	std::mutex mutex;
+	std::vector<TraceSpan> spans;
+	size_t written{0};
+	unsigned int id{0};
+	std::string name;
+};
+
+struct Registry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+	std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+};
+
+// Never destroyed, threads may still record spans while static destructors run.
+Registry &GetRegistry()
+{
+	static auto *registry = new Registry;
+	return *registry;
+}
+
+thread_local TraceBuffer *LocalBuffer = nullptr;
+
+thread_local std::string LocalName;
+
+TraceBuffer &GetLocalBuffer()
+{
+	if (!LocalBuffer) {
+		auto &registry = GetRegistry();
+		auto buffer = std::make_unique<TraceBuffer>();
+		buffer->spans.resize(TRACE_BUFFER_LENGTH);
+
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		buffer->id = (unsigned int)registry.buffers.size();
+		buffer->name = LocalName.empty() ? "thread " + std::to_string(buffer->id) : LocalName;
+		LocalBuffer = buffer.get();
+		registry.buffers.push_back(std::move(buffer));
+	}
+	return *LocalBuffer;
+}
+
+void WriteEscaped(std::ostream &out, std::string_view text)
+{
+	for (char c : text) {
+		switch (c) {
+			case '"':
+				out << "\\\"";
+				break;
+			case '\\':
+				out << "\\\\";
+				break;
+			default:
+				if ((unsigned char)c < 0x20) {
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)c);
+					out << escaped;
+				} else {
+					out << c;
+				}
+				break;
+		}
+	}
+}
+
+double ToMicroseconds(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}
+
+void detail::RecordSpan(SpanKind kind, std::string_view name,
+                        std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	auto &buffer = GetLocalBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	auto &span = buffer.spans[buffer.written % TRACE_BUFFER_LENGTH];
+	span.name = name;
+	span.kind = kind;
+	span.thread = buffer.id;
+	span.start = start;
+	span.end = end;
+	buffer.written++;
+}
+
+void detail::NameTraceThread(std::string name)
+{
+	if (LocalBuffer) {
+		std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+		LocalBuffer->name = name;
+	}
+	LocalName = std::move(name);
+}
+
+void SetTracing(bool enabled)
+{
+	detail::TracingEnabled = enabled;
+}
+
+void ClearTrace()
+{
+	auto &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (auto &buffer : registry.buffers) {
+		std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+		buffer->written = 0;
+	}
+}
+
+std::vector<TraceSpan> GetTrace()
+{
+	std::vector<TraceSpan> spans;
+
+	auto &registry = GetRegistry();
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (auto &buffer : registry.buffers) {
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			auto count = std::min(buffer->written, TRACE_BUFFER_LENGTH);
+			spans.insert(spans.end(), buffer->spans.begin(), buffer->spans.begin() + (long)count);
+		}
+	}
+
+	std::sort(spans.begin(), spans.end(), [](const TraceSpan &a, const TraceSpan &b)
+	{ return a.start < b.start; });
+	return spans;
+}
+
+std::vector<TraceThread> GetTraceThreads()
+{
+	std::vector<TraceThread> threads;
+
+	auto &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (auto &buffer : registry.buffers) {
+		threads.push_back({buffer->id, buffer->name});
+	}
+	return threads;
+}
+
+std::chrono::steady_clock::time_point GetTraceEpoch()
+{
+	return GetRegistry().epoch;
+}
+
+std::string_view GetSpanKindName(SpanKind kind)
+{
+	switch (kind) {
+		case SpanKind::Execute:
+			return "execute";
+		case SpanKind::QueueWait:
+			return "queue wait";
+		case SpanKind::Message:
+			return "message";
+		case SpanKind::NamedIteration:
+			return "named iteration";
+		default:
+			return "unknown";
+	}
+}
+
+bool ExportTrace(const std::filesystem::path &path)
+{
+	std::ofstream out(path);
+	if (!out) {
+		log::Error("Failed to open ", path, " for writing the task trace");
+		return false;
+	}
+
+	const auto epoch = GetTraceEpoch();
+	const auto spans = GetTrace();
+	const auto threads = GetTraceThreads();
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto &thread : threads) {
+		out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+		    << ",\"args\":{\"name\":\"";
+		WriteEscaped(out, thread.name);
+		out << "\"}}";
+		first = false;
+	}
+
+	char times[64];
+	for (const auto &span : spans) {
+		std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+		              ToMicroseconds(span.start - epoch), ToMicroseconds(span.end - span.start));
+		out << (first ? "" : ",") << "\n{\"name\":\"";
+		WriteEscaped(out, span.name);
+		out << "\",\"cat\":\"" << GetSpanKindName(span.kind) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+		    << "," << times << "}";
+		first = false;
+	}
+	out << "\n]}\n";
+
+	log::Info("Wrote ", spans.size(), " task trace spans to ", path);
+	return bool(out);
+}
+
+}
@@ -0,0 +1,133 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace tasks
+{
+
+/// Spans kept per thread, older ones get overwritten.
+constexpr size_t TRACE_BUFFER_LENGTH = 4096;
+
+enum class SpanKind
+{
+	Execute,        // One invoke() of a pool task.
+	QueueWait,      // Time between a task being queued and a thread picking it up.
+	Message,        // A message being handled by its receiving task.
+	NamedIteration, // One invoke() of a named task.
+	COUNT
+};
+
+struct TraceSpan
+{
+	std::string_view name;
+	SpanKind kind{SpanKind::Execute};
+	unsigned int thread{0};
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point end;
+};
+
+struct TraceThread
+{
+	unsigned int id{0};
+	std::string name;
+};
+
+namespace detail
+{
+
+extern std::atomic<bool> TracingEnabled;
+
+void RecordSpan(SpanKind kind, std::string_view name,
+                std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+/// Names the calling thread in traces.
+void NameTraceThread(std::string name);
+
+/// Records the lifetime of the scope as a span, if tracing was on when it was entered.
+class TraceScope
+{
+public:
+	TraceScope(SpanKind kindIn, std::string_view nameIn)
+		: kind(kindIn), name(nameIn), active(TracingEnabled.load(std::memory_order_relaxed))
+	{
+		if (active) {
+			start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~TraceScope()
+	{
+		if (active) {
+			RecordSpan(kind, name, start, std::chrono::steady_clock::now());
+		}
+	}
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+	SpanKind kind;
+	std::string_view name;
+	bool active;
+	std::chrono::steady_clock::time_point start;
+};
+
+}
+
+inline bool Tracing()
+{ return detail::TracingEnabled.load(std::memory_order_relaxed); }
+
+void SetTracing(bool enabled);
+
+/// Drops every recorded span.
+void ClearTrace();
+
+/// Copies the spans currently held by all threads, ordered by start time.
+std::vector<TraceSpan> GetTrace();
+
+std::vector<TraceThread> GetTraceThreads();
+
+/// Time all trace timestamps are relative to.
+std::chrono::steady_clock::time_point GetTraceEpoch();
+
+std::string_view GetSpanKindName(SpanKind kind);
+
+/**
+ * Writes the recorded spans as Chrome trace event JSON, loadable by chrome://tracing and Perfetto.
+ * @return False if the file could not be written.
+ */
+bool ExportTrace(const std::filesystem::path &path);
+
+}
+
+}
@@ -0,0 +1,170 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+
+#include "DirectoryWatcher.hpp"
+
+#include "Log.hpp"
+
+#ifdef LINUX
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace PROJECT_NAMESPACE {
+
+namespace files
+{
+
+#ifdef LINUX
+constexpr uint32_t WATCH_MASK =
+	IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+#endif
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	clear();
+}
+
+bool DirectoryWatcher::watch(const std::filesystem::path &root)
+{
+#ifdef LINUX
+	if (handle < 0) {
+		handle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (handle < 0) {
+			log::Warning("Unable to watch directories, errno ", errno);
+			return false;
+		}
+	}
+
+	auto watchCount = watches.size();
+	addTree(root, nullptr);
+	return watches.size() > watchCount;
+#else
+	log::Info("Watching directories is not supported on ", PLATFORM, ", ", root, " won't be watched");
+	return false;
+#endif
+}
+
+void DirectoryWatcher::addTree(const std::filesystem::path &root, std::vector<Change> *created)
+{
+#ifdef LINUX
+	auto addDirectory = [this](const std::filesystem::path &directory)
+	{
+		int descriptor = inotify_add_watch(handle, directory.c_str(), WATCH_MASK);
+		if (descriptor < 0) {
+			log::Warning("Unable to watch ", directory, ", errno ", errno);
+			return;
+		}
+		watches[descriptor] = directory;
+	};
+
+	addDirectory(root);
+
+	std::error_code ec;
+	auto options = std::filesystem::directory_options::skip_permission_denied;
+	for (auto it = std::filesystem::recursive_directory_iterator(root, options, ec);
+		 !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+		if (it->is_directory(ec)) {
+			addDirectory(it->path());
+		} else if (created) {
+			// these may have been written before the watch was in place, so nobody else will report them
+			created->push_back({ChangeType::Changed, it->path()});
+		}
+	}
+#else
+	(void) root;
+	(void) created;
+#endif
+}
+
+std::vector<Change> DirectoryWatcher::poll()
+{
+	std::vector<Change> changes;
+
+#ifdef LINUX
+	if (handle < 0) {
+		return changes;
+	}
+
+	alignas(inotify_event) char buffer[16 * 1024];
+
+	while (true) {
+		auto length = read(handle, buffer, sizeof(buffer));
+		if (length <= 0) {
+			// EAGAIN, nothing more to read
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < length;) {
+			const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+			offset += ssize_t(sizeof(inotify_event) + event->len);
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				changes.push_back({ChangeType::Overflow, {}});
+				continue;
+			}
+
+			auto watched = watches.find(event->wd);
+			if (watched == watches.end()) {
+				continue;
+			}
+
+			if (event->mask & IN_IGNORED) {
+				// the directory is gone, its removal was already reported by its parent
+				watches.erase(watched);
+				continue;
+			}
+
+			auto path = event->len > 0 ? watched->second / event->name : watched->second;
+
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				changes.push_back({ChangeType::Removed, path});
+			} else if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					addTree(path, &changes);
+				}
+			} else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+				// plain creation is skipped, the file is reported once it has been written
+				changes.push_back({ChangeType::Changed, path});
+			}
+		}
+	}
+#endif
+
+	return changes;
+}
+
+void DirectoryWatcher::clear()
+{
+#ifdef LINUX
+	if (handle >= 0) {
+		close(handle);
+	}
+#endif
+	handle = -1;
+	watches.clear();
+}
+
+}
+
+}
@@ -0,0 +1,89 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+
+#pragma once
+
+#include "define.hpp"
+
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace files
+{
+
+enum class ChangeType
+{
+	// A file was written to or moved in.
+	Changed,
+	// A file or a whole directory was deleted or moved out.
+	Removed,
+	// Events were lost, everything being watched should be rescanned.
+	Overflow,
+};
+
+struct Change
+{
+	ChangeType type;
+	std::filesystem::path path;
+};
+
+/**
+ * Watches directory trees for changes to the files inside them, without blocking.
+ * Only implemented on Linux (inotify), on other platforms watch() fails and no changes are ever reported.
+ */
+class DirectoryWatcher
+{
+public:
+	DirectoryWatcher() = default;
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher &) = delete;
+	DirectoryWatcher &operator=(const DirectoryWatcher &) = delete;
+
+	/**
+	 * Starts watching a directory and all of its subdirectories. Directories created later are watched as well.
+	 * @return Whether the directory could be watched.
+	 */
+	bool watch(const std::filesystem::path &root);
+
+	/**
+	 * Collects the changes since the last call.
+	 * Files in directories which were created or moved in are all reported as changed.
+	 */
+	std::vector<Change> poll();
+
+	/// Stops watching everything.
+	void clear();
+
+private:
+	void addTree(const std::filesystem::path &root, std::vector<Change> *created);
+
+	int handle{-1};
+	std::unordered_map<int, std::filesystem::path> watches;
+};
+
+}
+
+}
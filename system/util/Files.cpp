@@ -21,10 +21,28 @@
 //=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
 #include "Files.hpp"
 
+#include "Log.hpp"
+
 #include <memory>
 #include <algorithm>
 #include <utility>
 
+#ifdef WINDOWS
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#elif LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace PROJECT_NAMESPACE {
 
 namespace files
@@ -82,25 +100,108 @@ std::vector<std::filesystem::path> FindAll(const std::filesystem::path &pathPref
 		return ret;
 	}
 
-	for (auto &fileInPath :
-		std::filesystem::recursive_directory_iterator(pathPrefix)) {
-		if (fileInPath.is_directory()) {
+	std::vector<std::filesystem::path> pending{pathPrefix};
+	while (!pending.empty()) {
+		auto directory = std::move(pending.back());
+		pending.pop_back();
+		ListDirectory(directory, allowedExts, ret, &pending);
+	}
+
+	return ret;
+}
+
+bool HasExtension(std::string_view fileName, const std::vector<std::string> &allowedExts)
+{
+	if (allowedExts.empty()) {
+		return true;
+	}
+
+	// same rules as path::extension(), a leading dot starts the name instead of the extension
+	auto dot = fileName.rfind('.');
+	std::string_view extension;
+	if (dot != std::string_view::npos && dot != 0 && fileName != "..") {
+		extension = fileName.substr(dot);
+	}
+
+	return std::find(allowedExts.begin(), allowedExts.end(), extension) != allowedExts.end();
+}
+
+#ifdef LINUX
+
+bool ListDirectory(const std::filesystem::path &directory,
+				   const std::vector<std::string> &allowedExts,
+				   std::vector<std::filesystem::path> &files,
+				   std::vector<std::filesystem::path> *directories)
+{
+	DIR *stream = opendir(directory.c_str());
+	if (!stream) {
+		return false;
+	}
+
+	while (auto *entry = readdir(stream)) {
+		std::string_view name = entry->d_name;
+		if (name == "." || name == "..") {
 			continue;
 		}
-		const auto &thisPath = fileInPath.path();
 
-		if (!allowedExts.empty()) {
-			auto ext = thisPath.extension().string();
-			if (std::find(allowedExts.begin(), allowedExts.end(), ext) == allowedExts.end()) {
+		auto type = entry->d_type;
+		if (type == DT_UNKNOWN || type == DT_LNK) {
+			struct stat info{};
+			if (fstatat(dirfd(stream), entry->d_name, &info, 0) != 0) {
+				continue;
+			}
+			bool isDirectory = S_ISDIR(info.st_mode);
+			if (isDirectory && type == DT_LNK) {
 				continue;
 			}
+			type = isDirectory ? DT_DIR : DT_REG;
 		}
 
-		ret.push_back(thisPath);
+		if (type == DT_DIR) {
+			if (directories) {
+				directories->push_back(directory / name);
+			}
+		} else if (HasExtension(name, allowedExts)) {
+			files.push_back(directory / name);
+		}
 	}
 
-	return ret;
+	closedir(stream);
+	return true;
+}
+
+#else
+
+bool ListDirectory(const std::filesystem::path &directory,
+				   const std::vector<std::string> &allowedExts,
+				   std::vector<std::filesystem::path> &files,
+				   std::vector<std::filesystem::path> *directories)
+{
+	std::error_code ec;
+	std::filesystem::directory_iterator iterator(directory, ec);
+	if (ec) {
+		return false;
+	}
+
+	for (const auto &entry : iterator) {
+		if (entry.is_directory(ec)) {
+			if (directories && !entry.is_symlink(ec)) {
+				directories->push_back(entry.path());
+			}
+			continue;
+		}
+
+		const auto &path = entry.path();
+		if (HasExtension(path.filename().string(), allowedExts)) {
+			files.push_back(path);
+		}
+	}
+
+	return true;
 }
+
+#endif
+
 std::filesystem::path Get(const std::filesystem::path &pathIn,
 						  const std::filesystem::path &pathPrefix,
 						  const std::vector<std::string> &allowedExts,
@@ -166,6 +267,125 @@ MultiDirectorySearch::MultiDirectorySearch()
 	searchPaths.insert(searchPaths.begin(), std::filesystem::current_path());
 }
 
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+	open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+	if (this != &other) {
+		close();
+		address = std::exchange(other.address, nullptr);
+		length = std::exchange(other.length, 0);
+		opened = std::exchange(other.opened, false);
+#ifdef WINDOWS
+		fileHandle = std::exchange(other.fileHandle, nullptr);
+		mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::open(const std::filesystem::path &path)
+{
+	close();
+
+#ifdef WINDOWS
+	HANDLE file = CreateFileW(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+	);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	if (fileSize.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!view) {
+			log::Error("Failed to map ", path);
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+		mappingHandle = mapping;
+		address = static_cast<const char *>(view);
+		length = std::size_t(fileSize.QuadPart);
+	}
+	fileHandle = file;
+#elif LINUX
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info{};
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	if (info.st_size > 0) {
+		void *view = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED) {
+			log::Error("Failed to map ", path);
+			::close(fd);
+			return false;
+		}
+		madvise(view, std::size_t(info.st_size), MADV_SEQUENTIAL);
+		address = static_cast<const char *>(view);
+		length = std::size_t(info.st_size);
+	}
+	// the mapping keeps its own reference to the file
+	::close(fd);
+#endif
+
+	opened = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef WINDOWS
+	if (address) {
+		UnmapViewOfFile(address);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle) {
+		CloseHandle(fileHandle);
+	}
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#elif LINUX
+	if (address) {
+		munmap(const_cast<char *>(address), length);
+	}
+#endif
+	address = nullptr;
+	length = 0;
+	opened = false;
+}
+
 }
 
 }
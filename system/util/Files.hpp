@@ -26,6 +26,7 @@
 #include <filesystem>
 #include <vector>
 #include <optional>
+#include <string_view>
 
 namespace PROJECT_NAMESPACE {
 
@@ -35,6 +36,28 @@ namespace files
 std::vector<std::filesystem::path> FindAll(const std::filesystem::path &pathPrefix,
 										   const std::vector<std::string> &allowedExts = {});
 
+/**
+ * Lists the entries of a single directory without recursing into it.
+ * File types come straight from the directory listing where the platform reports them, so unlike
+ * std::filesystem::directory_iterator an entry is only stat'ed on its own when it's a symlink or the type is unknown.
+ * Symlinks to directories are skipped, just like FindAll never follows them.
+ * @param directory Directory to list.
+ * @param allowedExts Extensions of the files to list, every file is listed if it's empty.
+ * @param files Receives the files.
+ * @param directories Receives the subdirectories, may be null.
+ * @return Whether the directory could be read.
+ */
+bool ListDirectory(const std::filesystem::path &directory,
+				   const std::vector<std::string> &allowedExts,
+				   std::vector<std::filesystem::path> &files,
+				   std::vector<std::filesystem::path> *directories);
+
+/**
+ * Checks the extension of a file name against a list without building a path out of it.
+ * @return Whether the extension is in allowedExts or allowedExts is empty.
+ */
+bool HasExtension(std::string_view fileName, const std::vector<std::string> &allowedExts);
+
 std::filesystem::path Get(const std::filesystem::path &pathIn,
 						  const std::filesystem::path &pathPrefix,
 						  const std::vector<std::string> &allowedExts = {},
@@ -65,13 +88,53 @@ public:
 	inline PathCollectionType::iterator begin() { return searchPaths.begin(); }
 	inline PathCollectionType::iterator end() { return searchPaths.end(); }
 
-	inline PathCollectionType::const_iterator cbegin() { return searchPaths.cbegin(); }
-	inline PathCollectionType::const_iterator cend() { return searchPaths.cend(); }
+	inline PathCollectionType::const_iterator cbegin() const { return searchPaths.cbegin(); }
+	inline PathCollectionType::const_iterator cend() const { return searchPaths.cend(); }
 
 private:
 	PathCollectionType searchPaths;
 };
 
+/**
+ * A read-only view of a whole file mapped into memory.
+ * The contents stay valid for as long as the MappedFile is open, parsers can therefore hand out string_views into it
+ * instead of copying every field they read.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+
+	/**
+	 * Maps the file at path, closing any previously mapped file.
+	 * @param path Path to the file.
+	 * @return Whether the file could be opened. An empty file is opened successfully and has an empty view.
+	 */
+	bool open(const std::filesystem::path &path);
+	void close();
+
+	[[nodiscard]] inline bool isOpen() const { return opened; }
+	[[nodiscard]] inline std::size_t size() const { return length; }
+	[[nodiscard]] inline const char *data() const { return address; }
+	[[nodiscard]] inline std::string_view view() const { return {address, length}; }
+
+private:
+	const char *address{nullptr};
+	std::size_t length{0};
+	bool opened{false};
+#ifdef WINDOWS
+	void *fileHandle{nullptr};
+	void *mappingHandle{nullptr};
+#endif
+};
+
 }
 
 }
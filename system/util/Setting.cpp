@@ -26,6 +26,29 @@
 
 namespace PROJECT_NAMESPACE {
 
+detail::BaseSetting::BaseSetting(SettingType typeIn) noexcept
+    : type(typeIn)
+{}
+
+SettingType detail::BaseSetting::getType() const
+{
+    return type;
+}
+
+bool detail::BaseSetting::wasChanged()
+{
+	return false;
+}
+
+SettingFlags detail::BaseSetting::flags() const
+{
+	return DEFAULT_SETTING_FLAGS;
+}
+bool detail::BaseSetting::changed() const
+{
+	return false;
+}
+
 #define TO_STRING_FUNC(Type, SettingType) \
     template<> const detail::SettingMetadataFields<Type, SettingType>::ToStringFunction \
     detail::SettingMetadataFields<Type, SettingType>::toString = [](const Type& value) -> std::string
@@ -92,10 +92,6 @@ bool Settings::read(const std::filesystem::path &path)
     return !read.isEmpty();
 }
 
-detail::BaseSetting::BaseSetting(SettingType typeIn) noexcept
-    : type(typeIn)
-{}
-
 void Settings::apply()
 {
     log::Debug("Invoking callbacks");
@@ -109,25 +105,6 @@ void Settings::apply()
 
 }
 
-SettingType detail::BaseSetting::getType() const
-{
-    return type;
-}
-
-bool detail::BaseSetting::wasChanged()
-{
-	return false;
-}
-
-SettingFlags detail::BaseSetting::flags() const
-{
-	return DEFAULT_SETTING_FLAGS;
-}
-bool detail::BaseSetting::changed() const
-{
-	return false;
-}
-
 Settings::ActiveSettingStorageT::iterator Settings::begin()
 {
     return activeValues.begin();
@@ -87,6 +87,27 @@ namespace PROJECT_NAMESPACE
         return s;
     }
 
+    std::string_view LTrimView(std::string_view s)
+    {
+        auto first = std::find_if(s.begin(), s.end(), [](unsigned char ch)
+                                  { return !std::isspace(ch); });
+        s.remove_prefix(std::size_t(first - s.begin()));
+        return s;
+    }
+
+    std::string_view RTrimView(std::string_view s)
+    {
+        auto last = std::find_if(s.rbegin(), s.rend(), [](unsigned char ch)
+                                 { return !std::isspace(ch); });
+        s.remove_suffix(std::size_t(last - s.rbegin()));
+        return s;
+    }
+
+    std::string_view TrimView(std::string_view s)
+    {
+        return RTrimView(LTrimView(s));
+    }
+
     std::string ToUTF8(const std::u16string &s)
     {
         std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> conv;
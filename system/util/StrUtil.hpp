@@ -22,6 +22,7 @@
 #include "define.hpp"
 
 #include <string>
+#include <string_view>
 
 #include "ToFromString.hpp"
 
@@ -62,6 +63,10 @@ std::string LTrimCopy(std::string s);
 std::string RTrimCopy(std::string s);
 std::string TrimCopy(std::string s);
 
+std::string_view LTrimView(std::string_view s);
+std::string_view RTrimView(std::string_view s);
+std::string_view TrimView(std::string_view s);
+
 std::string ToUTF8(const std::u16string &s);
 std::string ToUTF8(const std::u32string &s);
 
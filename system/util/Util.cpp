@@ -22,12 +22,15 @@
 
 #include "Util.hpp"
 
+#ifndef HEADLESS
 #include "GL.hpp"
 
+#include <AL/al.h>
+#endif
+
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
-#include <AL/al.h>
 #include <algorithm>
 
 namespace PROJECT_NAMESPACE {
@@ -40,6 +43,7 @@ int CheckGLFWErrors(const std::string &file, int line,
     return 0;
 }
 
+#ifndef HEADLESS
 unsigned int CheckGLErrors(const std::string &file, int line,
                          const std::string &helper)
 {
@@ -110,10 +114,13 @@ unsigned int CheckALErrors(const std::string& file, int line, const std::string&
 	}
 	return error;
 }
+#endif
 } // namespace detail
 
+#ifndef HEADLESS
 unsigned int DumpGlErrors()
 { return glGetError(); }
+#endif
 
 std::vector<std::string> GetCharacterSeparatedValues(const std::string &in, char sep)
 {
@@ -30,6 +30,8 @@
 #include <vector>
 #include <locale>
 #include <codecvt>
+#include <charconv>
+#include <string_view>
 
 namespace PROJECT_NAMESPACE {
 
@@ -40,6 +42,8 @@ int CheckGLFWErrors(
     const std::string &helper = ""
 );
 
+// The headless build has no GL context or audio device to check.
+#ifndef HEADLESS
 unsigned int CheckGLErrors(
     const std::string &file, int line,
     const std::string &helper = ""
@@ -49,6 +53,7 @@ unsigned int CheckALErrors(
     const std::string &file, int line,
     const std::string &helper = ""
 );
+#endif
 }
 
 #define CheckGLFW PROJECT_NAMESPACE::detail::CheckGLFWErrors(__FILE__, __LINE__)
@@ -59,7 +64,9 @@ unsigned int CheckALErrors(
 #define CheckGLh(_helper) PROJECT_NAMESPACE::detail::CheckGLErrors(__FILE__, __LINE__, _helper)
 #define CheckALh(_helper) PROJECT_NAMESPACE::detail::CheckALErrors(__FILE__, __LINE__, _helper)
 
+#ifndef HEADLESS
 unsigned int DumpGlErrors();
+#endif
 
 std::vector<std::string> GetCharacterSeparatedValues(const std::string &in, char sep);
 
@@ -85,4 +92,41 @@ static T GetParam(const std::vector<std::string> &params, unsigned int param, T
     return backup;
 }
 
+/**
+ * Splits off the next value of a character separated list without copying it.
+ * @param in The remaining list, the returned value and its separator are removed from it.
+ * @param sep The separator.
+ * @return The next value, which may be empty.
+ */
+inline std::string_view PopSeparatedValue(std::string_view &in, char sep) noexcept
+{
+    auto end = in.find(sep);
+    auto value = in.substr(0, end);
+    in.remove_prefix(end == std::string_view::npos ? in.size() : end + 1);
+    return value;
+}
+
+/**
+ * Parses a number from a string_view, the string_view counterpart of GetParam.
+ * Like strtod, leading whitespace and trailing garbage are ignored and integers are parsed as decimals before being
+ * converted.
+ * @param str The string to parse.
+ * @param backup Returned if no number could be read.
+ */
+template<typename T>
+static T ParseNumber(std::string_view str, T backup) noexcept
+{
+    str = LTrimView(str);
+    if (str.starts_with('+')) {
+        str.remove_prefix(1);
+    }
+
+    double value;
+    auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc()) {
+        return backup;
+    }
+    return static_cast<T>(value);
+}
+
 }
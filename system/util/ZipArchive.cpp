@@ -0,0 +1,530 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#include "ZipArchive.hpp"
+
+#include "Log.hpp"
+
+// stb_image is compiled here rather than with the images, the headless build has archives but no images.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <mutex>
+
+namespace PROJECT_NAMESPACE {
+
+namespace files
+{
+
+namespace
+{
+
+constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+constexpr uint32_t CENTRAL_DIRECTORY_SIGNATURE = 0x02014b50;
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+
+constexpr size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+constexpr size_t CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr size_t MAX_COMMENT_SIZE = 0xffff;
+
+constexpr uint16_t METHOD_STORED = 0;
+constexpr uint16_t METHOD_DEFLATED = 8;
+constexpr uint16_t FLAG_ENCRYPTED = 1 << 0;
+constexpr uint16_t FLAG_UTF8_NAME = 1 << 11;
+
+// Version 2.0 of the format, the earliest one that knows about directories and deflate.
+constexpr uint16_t ZIP_VERSION = 20;
+// Midnight of the first of January 1980 in MS-DOS format, the timestamp of members written by WriteArchive.
+constexpr uint16_t DOS_DATE_EPOCH = (1 << 5) | 1;
+
+/// How many archives ZipArchive::Get keeps open.
+constexpr size_t OPEN_ARCHIVE_LIMIT = 16;
+
+/// Zip fields are little endian and unaligned.
+template<typename T>
+T ReadLE(const char *data)
+{
+	T value = 0;
+	for (size_t i = 0; i < sizeof(T); i++) {
+		value |= T(uint8_t(data[i])) << (8 * i);
+	}
+	return value;
+}
+
+template<typename T>
+void WriteLE(std::string &out, T value)
+{
+	for (size_t i = 0; i < sizeof(T); i++) {
+		out.push_back(char(uint8_t(value >> (8 * i))));
+	}
+}
+
+uint32_t Crc32(std::string_view data)
+{
+	static const auto table = []()
+	{
+		std::array<uint32_t, 256> entries{};
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++) {
+				value = (value & 1) ? (0xedb88320 ^ (value >> 1)) : (value >> 1);
+			}
+			entries[i] = value;
+		}
+		return entries;
+	}();
+
+	uint32_t crc = 0xffffffff;
+	for (char c : data) {
+		crc = table[(crc ^ uint8_t(c)) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffff;
+}
+
+/// The fields local headers and central directory headers share, from the version needed onwards.
+void WriteCommonHeader(std::string &out, const ZipArchive::Entry &entry)
+{
+	WriteLE<uint16_t>(out, ZIP_VERSION);
+	WriteLE<uint16_t>(out, FLAG_UTF8_NAME);
+	WriteLE<uint16_t>(out, METHOD_STORED);
+	WriteLE<uint16_t>(out, 0);
+	WriteLE<uint16_t>(out, DOS_DATE_EPOCH);
+	WriteLE<uint32_t>(out, entry.crc);
+	WriteLE<uint32_t>(out, uint32_t(entry.compressedSize));
+	WriteLE<uint32_t>(out, uint32_t(entry.size));
+	WriteLE<uint16_t>(out, uint16_t(entry.name.size()));
+	WriteLE<uint16_t>(out, 0);
+}
+
+struct OpenArchive
+{
+	std::filesystem::path path;
+	std::filesystem::file_time_type modified;
+	std::shared_ptr<const ZipArchive> archive;
+};
+
+std::mutex openArchivesMutex;
+// Most recently used first.
+std::list<OpenArchive> openArchives;
+
+}
+
+const std::vector<std::string> &GetArchiveExtensions()
+{
+	static const std::vector<std::string> extensions = {".osz", ".zip"};
+	return extensions;
+}
+
+std::shared_ptr<const ZipArchive> ZipArchive::Get(const std::filesystem::path &path)
+{
+	std::error_code ec;
+	auto modified = std::filesystem::last_write_time(path, ec);
+	if (ec) {
+		return nullptr;
+	}
+
+	{
+		std::scoped_lock lock(openArchivesMutex);
+		auto it = std::find_if(openArchives.begin(), openArchives.end(), [&path](const OpenArchive &open)
+		{ return open.path == path; });
+		if (it != openArchives.end()) {
+			if (it->modified == modified) {
+				openArchives.splice(openArchives.begin(), openArchives, it);
+				return it->archive;
+			}
+			openArchives.erase(it);
+		}
+	}
+
+	// indexing happens outside the lock, two threads opening the same archive at once both just index it
+	auto archive = std::make_shared<ZipArchive>();
+	if (!archive->open(path)) {
+		return nullptr;
+	}
+
+	std::scoped_lock lock(openArchivesMutex);
+	openArchives.push_front(OpenArchive{path, modified, archive});
+	if (openArchives.size() > OPEN_ARCHIVE_LIMIT) {
+		openArchives.pop_back();
+	}
+	return archive;
+}
+
+bool ZipArchive::open(const std::filesystem::path &pathIn)
+{
+	path = pathIn;
+	entries.clear();
+	index.clear();
+
+	if (!file.open(path)) {
+		log::Warning("Unable to open archive ", path);
+		return false;
+	}
+
+	auto data = file.view();
+	if (data.size() < END_OF_CENTRAL_DIRECTORY_SIZE) {
+		log::Warning(path, " is not a zip archive");
+		return false;
+	}
+
+	// the end record sits right before the archive comment, which is at most 64 KiB long
+	size_t end = data.size() - END_OF_CENTRAL_DIRECTORY_SIZE;
+	size_t searchLimit = end > MAX_COMMENT_SIZE ? end - MAX_COMMENT_SIZE : 0;
+	while (ReadLE<uint32_t>(data.data() + end) != END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+		if (end == searchLimit) {
+			log::Warning(path, " is not a zip archive");
+			return false;
+		}
+		end--;
+	}
+
+	auto entryCount = ReadLE<uint16_t>(data.data() + end + 10);
+	auto directorySize = ReadLE<uint32_t>(data.data() + end + 12);
+	auto directoryOffset = ReadLE<uint32_t>(data.data() + end + 16);
+
+	if (entryCount == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff) {
+		log::Warning(path, " is a zip64 archive, which is not supported");
+		return false;
+	}
+	if (uint64_t(directoryOffset) + directorySize > end) {
+		log::Warning("The central directory of ", path, " is corrupted");
+		return false;
+	}
+
+	entries.reserve(entryCount);
+	index.reserve(entryCount);
+
+	size_t position = directoryOffset;
+	size_t directoryEnd = size_t(directoryOffset) + directorySize;
+	for (unsigned int i = 0; i < entryCount; i++) {
+		if (position + CENTRAL_DIRECTORY_HEADER_SIZE > directoryEnd ||
+			ReadLE<uint32_t>(data.data() + position) != CENTRAL_DIRECTORY_SIGNATURE) {
+			log::Warning("The central directory of ", path, " is corrupted");
+			entries.clear();
+			index.clear();
+			return false;
+		}
+
+		const char *header = data.data() + position;
+		auto flags = ReadLE<uint16_t>(header + 8);
+		auto nameLength = ReadLE<uint16_t>(header + 28);
+		auto extraLength = ReadLE<uint16_t>(header + 30);
+		auto commentLength = ReadLE<uint16_t>(header + 32);
+
+		if (position + CENTRAL_DIRECTORY_HEADER_SIZE + nameLength > directoryEnd) {
+			log::Warning("The central directory of ", path, " is corrupted");
+			entries.clear();
+			index.clear();
+			return false;
+		}
+
+		Entry entry;
+		entry.method = ReadLE<uint16_t>(header + 10);
+		entry.crc = ReadLE<uint32_t>(header + 16);
+		entry.compressedSize = ReadLE<uint32_t>(header + 20);
+		entry.size = ReadLE<uint32_t>(header + 24);
+		entry.localHeaderOffset = ReadLE<uint32_t>(header + 42);
+		entry.name.assign(header + CENTRAL_DIRECTORY_HEADER_SIZE, nameLength);
+		std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+
+		position += CENTRAL_DIRECTORY_HEADER_SIZE + nameLength + extraLength + commentLength;
+
+		// directories and members we can't read anyway
+		if (entry.name.empty() || entry.name.back() == '/' || (flags & FLAG_ENCRYPTED)) {
+			continue;
+		}
+
+		index.emplace(NormalizeName(entry.name), entries.size());
+		entries.push_back(std::move(entry));
+	}
+
+	return true;
+}
+
+const std::vector<ZipArchive::Entry> &ZipArchive::getEntries() const
+{
+	return entries;
+}
+
+const ZipArchive::Entry *ZipArchive::find(std::string_view name) const
+{
+	auto it = index.find(NormalizeName(name));
+	return it == index.end() ? nullptr : &entries[it->second];
+}
+
+std::optional<std::string_view> ZipArchive::locate(const Entry &entry) const
+{
+	auto data = file.view();
+
+	if (entry.localHeaderOffset + LOCAL_HEADER_SIZE > data.size() ||
+		ReadLE<uint32_t>(data.data() + entry.localHeaderOffset) != LOCAL_HEADER_SIGNATURE) {
+		log::Warning("Corrupted member ", entry.name, " in ", path);
+		return {};
+	}
+
+	// the local header may carry a different extra field than the central directory
+	const char *header = data.data() + entry.localHeaderOffset;
+	uint64_t start = entry.localHeaderOffset + LOCAL_HEADER_SIZE +
+					 ReadLE<uint16_t>(header + 26) + ReadLE<uint16_t>(header + 28);
+	if (start + entry.compressedSize > data.size()) {
+		log::Warning("Truncated member ", entry.name, " in ", path);
+		return {};
+	}
+
+	return data.substr(start, entry.compressedSize);
+}
+
+bool ZipArchive::read(const Entry &entry, std::string &contents) const
+{
+	auto compressed = locate(entry);
+	if (!compressed) {
+		return false;
+	}
+
+	switch (entry.method) {
+		case METHOD_STORED:
+			contents.assign(*compressed);
+			return true;
+		case METHOD_DEFLATED: {
+			if (entry.size > uint64_t(std::numeric_limits<int>::max()) ||
+				entry.compressedSize > uint64_t(std::numeric_limits<int>::max())) {
+				log::Warning("Member ", entry.name, " in ", path, " is too large");
+				return false;
+			}
+			contents.resize(entry.size);
+			// stb_image carries an inflater for PNGs, zip members are raw deflate streams without the zlib header
+			int written = stbi_zlib_decode_noheader_buffer(
+				contents.data(), int(entry.size), compressed->data(), int(compressed->size()));
+			if (written != int(entry.size)) {
+				log::Warning("Failed to decompress ", entry.name, " in ", path);
+				contents.clear();
+				return false;
+			}
+			return true;
+		}
+		default:
+			log::Warning("Member ", entry.name, " in ", path, " uses unsupported compression method ", entry.method);
+			return false;
+	}
+}
+
+std::optional<std::string_view> ZipArchive::view(const Entry &entry) const
+{
+	if (entry.method != METHOD_STORED) {
+		return {};
+	}
+	return locate(entry);
+}
+
+std::string ZipArchive::NormalizeName(std::string_view name)
+{
+	std::string normalized(name);
+	for (auto &c : normalized) {
+		if (c == '\\') {
+			c = '/';
+		} else if (c >= 'A' && c <= 'Z') {
+			c = char(c - 'A' + 'a');
+		}
+	}
+	return normalized;
+}
+
+std::optional<ArchivePath> SplitArchivePath(const std::filesystem::path &path)
+{
+	std::filesystem::path archive;
+	for (auto it = path.begin(); it != path.end(); it++) {
+		archive /= *it;
+
+		if (!HasExtension(it->string(), GetArchiveExtensions()) || std::next(it) == path.end()) {
+			continue;
+		}
+		if (!std::filesystem::is_regular_file(archive)) {
+			continue;
+		}
+
+		ArchivePath split;
+		split.archive = std::move(archive);
+		std::filesystem::path member;
+		for (it++; it != path.end(); it++) {
+			member /= *it;
+		}
+		split.member = member.generic_string();
+		return split;
+	}
+	return {};
+}
+
+bool ReadArchiveMember(const ArchivePath &path, std::string &contents)
+{
+	auto archive = ZipArchive::Get(path.archive);
+	const auto *entry = archive ? archive->find(path.member) : nullptr;
+	if (!entry) {
+		return false;
+	}
+	return archive->read(*entry, contents);
+}
+
+bool ReadContents(const std::filesystem::path &path, std::string &contents)
+{
+	if (auto split = SplitArchivePath(path)) {
+		return ReadArchiveMember(*split, contents);
+	}
+
+	MappedFile file;
+	if (!file.open(path)) {
+		return false;
+	}
+	contents.assign(file.view());
+	return true;
+}
+
+bool WriteArchive(const std::filesystem::path &directory, const std::filesystem::path &archive)
+{
+	std::error_code ec;
+	std::vector<std::filesystem::path> files;
+	for (auto it = std::filesystem::recursive_directory_iterator(directory, ec);
+		 !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+		if (it->is_regular_file(ec)) {
+			files.push_back(it->path());
+		}
+	}
+	if (ec) {
+		log::Warning("Unable to list ", directory, ": ", ec.message());
+		return false;
+	}
+	if (files.size() >= 0xffff) {
+		log::Warning(directory, " holds too many files for an archive");
+		return false;
+	}
+	// sorted so packing the same directory twice gives the same archive
+	std::sort(files.begin(), files.end());
+
+	auto temporary = archive;
+	temporary += ".tmp";
+
+	std::vector<ZipArchive::Entry> written;
+	written.reserve(files.size());
+	{
+		std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+		if (!ofs.is_open()) {
+			log::Warning("Unable to write archive ", archive);
+			return false;
+		}
+
+		uint64_t offset = 0;
+		std::string header;
+		for (const auto &file : files) {
+			MappedFile contents;
+			if (!contents.open(file)) {
+				log::Warning("Unable to read ", file, " while packing ", archive);
+				ofs.close();
+				std::filesystem::remove(temporary, ec);
+				return false;
+			}
+			auto data = contents.view();
+
+			ZipArchive::Entry entry;
+			auto name = std::filesystem::relative(file, directory, ec).generic_u8string();
+			entry.name.assign(name.begin(), name.end());
+			entry.localHeaderOffset = offset;
+			entry.compressedSize = entry.size = data.size();
+			entry.crc = Crc32(data);
+			entry.method = METHOD_STORED;
+
+			offset += LOCAL_HEADER_SIZE + entry.name.size() + data.size();
+			if (ec || entry.name.size() > 0xffff || offset >= 0xffffffff) {
+				log::Warning("Unable to pack ", file, " into ", archive);
+				ofs.close();
+				std::filesystem::remove(temporary, ec);
+				return false;
+			}
+
+			header.clear();
+			WriteLE<uint32_t>(header, LOCAL_HEADER_SIGNATURE);
+			WriteCommonHeader(header, entry);
+			header += entry.name;
+			ofs.write(header.data(), std::streamsize(header.size()));
+			ofs.write(data.data(), std::streamsize(data.size()));
+
+			written.push_back(std::move(entry));
+		}
+
+		std::string directoryRecords;
+		for (const auto &entry : written) {
+			WriteLE<uint32_t>(directoryRecords, CENTRAL_DIRECTORY_SIGNATURE);
+			WriteLE<uint16_t>(directoryRecords, ZIP_VERSION);
+			WriteCommonHeader(directoryRecords, entry);
+			// comment length, disk number, internal and external attributes
+			WriteLE<uint16_t>(directoryRecords, 0);
+			WriteLE<uint16_t>(directoryRecords, 0);
+			WriteLE<uint16_t>(directoryRecords, 0);
+			WriteLE<uint32_t>(directoryRecords, 0);
+			WriteLE<uint32_t>(directoryRecords, uint32_t(entry.localHeaderOffset));
+			directoryRecords += entry.name;
+		}
+
+		if (offset + directoryRecords.size() >= 0xffffffff) {
+			log::Warning(directory, " is too large for an archive");
+			ofs.close();
+			std::filesystem::remove(temporary, ec);
+			return false;
+		}
+
+		std::string end;
+		WriteLE<uint32_t>(end, END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+		WriteLE<uint16_t>(end, 0);
+		WriteLE<uint16_t>(end, 0);
+		WriteLE<uint16_t>(end, uint16_t(written.size()));
+		WriteLE<uint16_t>(end, uint16_t(written.size()));
+		WriteLE<uint32_t>(end, uint32_t(directoryRecords.size()));
+		WriteLE<uint32_t>(end, uint32_t(offset));
+		WriteLE<uint16_t>(end, 0);
+
+		ofs.write(directoryRecords.data(), std::streamsize(directoryRecords.size()));
+		ofs.write(end.data(), std::streamsize(end.size()));
+
+		if (!ofs.good()) {
+			log::Warning("Failed writing archive ", archive);
+			ofs.close();
+			std::filesystem::remove(temporary, ec);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary, archive, ec);
+	if (ec) {
+		log::Warning("Unable to move archive ", archive, " in place: ", ec.message());
+		std::filesystem::remove(temporary, ec);
+		return false;
+	}
+	return true;
+}
+
+}
+
+}
@@ -0,0 +1,148 @@
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+// Copyright (c) 2022 sijh (s1Jh.199[at]gmail.com)
+//                                      =*=
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//                                      =*=
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//                                      =*=
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.                            =*=
+//=*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*==*=
+#pragma once
+
+#include "define.hpp"
+
+#include "Files.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace PROJECT_NAMESPACE {
+
+namespace files
+{
+
+/// Extensions of the zip archives whose members can be addressed like files in a directory.
+const std::vector<std::string> &GetArchiveExtensions();
+
+/**
+ * A read-only zip archive, such as an .osz map set.
+ *
+ * The archive is memory mapped and its central directory indexed once on open, members are only decompressed when
+ * they're read. Stored and deflated members are supported, zip64 and encrypted archives are not.
+ * All const members may be called from several threads at once.
+ */
+class ZipArchive
+{
+public:
+	struct Entry
+	{
+		// Name of the member as stored in the archive, '/' separated.
+		std::string name;
+		uint64_t localHeaderOffset{0};
+		uint64_t compressedSize{0};
+		uint64_t size{0};
+		uint32_t crc{0};
+		uint16_t method{0};
+	};
+
+	/**
+	 * Opens an archive or returns the already opened copy of it, as long as the file hasn't changed since.
+	 * A handful of recently used archives are kept open so that loading several members of the same map set only
+	 * indexes it once.
+	 * @return The archive or null if it couldn't be opened.
+	 */
+	static std::shared_ptr<const ZipArchive> Get(const std::filesystem::path &path);
+
+	bool open(const std::filesystem::path &path);
+
+	[[nodiscard]] const std::vector<Entry> &getEntries() const;
+
+	/**
+	 * Looks a member up by name, ignoring case and the kind of slashes used like the file systems of Windows do.
+	 * @return The member or null if the archive has none of that name.
+	 */
+	[[nodiscard]] const Entry *find(std::string_view name) const;
+
+	/**
+	 * Decompresses a member.
+	 * @param contents Receives the contents of the member.
+	 * @return Whether the member could be read.
+	 */
+	bool read(const Entry &entry, std::string &contents) const;
+
+	/**
+	 * Gives access to an uncompressed member without copying it, media files are usually stored that way.
+	 * The view is valid for as long as the archive is.
+	 * @return The contents of the member or nothing if it's compressed or corrupted.
+	 */
+	[[nodiscard]] std::optional<std::string_view> view(const Entry &entry) const;
+
+private:
+	static std::string NormalizeName(std::string_view name);
+
+	/// Finds the possibly compressed data of a member behind its local header.
+	[[nodiscard]] std::optional<std::string_view> locate(const Entry &entry) const;
+
+	std::filesystem::path path;
+	MappedFile file;
+	std::vector<Entry> entries;
+	std::unordered_map<std::string, size_t> index;
+};
+
+/// A path pointing into an archive, split at the archive.
+struct ArchivePath
+{
+	std::filesystem::path archive;
+	std::string member;
+};
+
+/**
+ * Splits paths like "songs/set.osz/map.osu" into the archive and the name of the member inside of it.
+ * Only the file system is consulted and only if one of the parent directories has an archive extension.
+ * @return The split path or nothing if the path doesn't lead into an archive.
+ */
+std::optional<ArchivePath> SplitArchivePath(const std::filesystem::path &path);
+
+/**
+ * Reads a whole member of an archive.
+ * @param contents Receives the contents.
+ * @return Whether the archive could be opened and has the member.
+ */
+bool ReadArchiveMember(const ArchivePath &path, std::string &contents);
+
+/**
+ * Reads a whole file, which may be a member of an archive.
+ * @param contents Receives the contents.
+ * @return Whether the file could be read.
+ */
+bool ReadContents(const std::filesystem::path &path, std::string &contents);
+
+/**
+ * Packs every file below a directory into a new archive, like osu! does when exporting a map set.
+ * Members are stored without compression, which keeps them readable through ZipArchive::view.
+ * The archive is written next to its destination first and only moved in place once it's complete.
+ * @return Whether the archive was written, it can't be over 4 GiB or hold more than 65535 files.
+ */
+bool WriteArchive(const std::filesystem::path &directory, const std::filesystem::path &archive);
+
+}
+
+}
@@ -21,10 +21,11 @@
  ******************************************************************************/
 #include "Image.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
 #include "Util.hpp"
+#include "ZipArchive.hpp"
+#include "Co.hpp"
 
 #include <cstring>
 
@@ -127,9 +128,48 @@ void Image::free()
 
 }
 
+/// Copies pixels decoded by stb into the image and frees them.
+static Resource<video::Image> AdoptDecoded(Resource<video::Image> r, color8 *data, int width, int height)
+{
+	if (!data) {
+		return {nullptr};
+	}
+
+	r->resize(width, height, true);
+
+	auto *destination = r->getPixels();
+
+	std::memcpy(destination, data, width * height * sizeof(color8));
+
+	stbi_image_free(data);
+
+	return r;
+}
+
+/// Decodes an image file read into memory.
+static Resource<video::Image> DecodeContents(const std::string &contents)
+{
+	Resource<video::Image> r;
+
+	int width, height, channels;
+
+	auto *data = (color8 *)stbi_load_from_memory(
+		(const stbi_uc *)contents.data(), (int)contents.size(), &width, &height, &channels, STBI_rgb_alpha);
+
+	return AdoptDecoded(r, data, width, height);
+}
+
 template<>
 Resource<video::Image> Load(const std::filesystem::path &path)
 {
+	if (auto member = files::SplitArchivePath(path)) {
+		std::string contents;
+		if (!files::ReadArchiveMember(*member, contents)) {
+			return {nullptr};
+		}
+		return DecodeContents(contents);
+	}
+
 	Resource<video::Image> r;
 
 #ifdef LINUX
@@ -143,22 +183,22 @@ Resource<video::Image> Load(const std::filesystem::path &path)
 
 	auto *data = (color8 *)stbi_load(ptr, &width, &height, &channels, STBI_rgb_alpha);
 
-	if (!data) {
-		return {nullptr};
-	}
-
-	r->resize(width, height, true);
-
-	auto *destination = r->getPixels();
-
-	std::memcpy(destination, data, width * height * sizeof(color8));
-
-	stbi_image_free(data);
-
 //    log::Info("Loaded image ", path, " Dimensions: ", width, " x ",
 //              std::to_string(height), " Channels: ", channels);
 
-	return r;
+	return AdoptDecoded(r, data, width, height);
+}
+
+template<>
+tasks::Co<Resource<video::Image>> LoadAsync(std::filesystem::path path)
+{
+	// The read happens on an IO thread, the decode back on the pool.
+	auto contents = co_await tasks::ReadFile(path);
+	if (!contents) {
+		co_return {nullptr};
+	}
+
+	co_return DecodeContents(*contents);
 }
 
 }
\ No newline at end of file
@@ -76,4 +76,7 @@ private:
 template<>
 Resource<video::Image> Load(const std::filesystem::path& path);
 
+template<>
+tasks::Co<Resource<video::Image>> LoadAsync(std::filesystem::path path);
+
 }
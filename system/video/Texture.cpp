@@ -24,6 +24,7 @@
 
 #include "Math.hpp"
 #include "Util.hpp"
+#include "Co.hpp"
 #include "GL.hpp"
 
 namespace PROJECT_NAMESPACE {
@@ -154,6 +155,21 @@ Resource<video::Texture> Load(const std::filesystem::path &location)
 	return tex;
 }
 
+template<>
+tasks::Co<Resource<video::Texture>> LoadAsync(std::filesystem::path location)
+{
+	Resource<video::Image> texImg = co_await LoadAsync<video::Image>(std::move(location));
+
+	if (!texImg) {
+		co_return {nullptr};
+	}
+
+	Resource<video::Texture> tex;
+	tex->setImage(*texImg);
+
+	co_return tex;
+}
+
 template<>
 Resource<video::Texture> Create()
 {
@@ -77,6 +77,9 @@ private:
 template<>
 Resource<video::Texture> Load(const std::filesystem::path&);
 
+template<>
+tasks::Co<Resource<video::Texture>> LoadAsync(std::filesystem::path);
+
 template<>
 Resource<video::Texture> Create();
 
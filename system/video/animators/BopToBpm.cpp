@@ -28,6 +28,8 @@
 
 #include "Math.hpp"
 
+#include <utility>
+
 namespace PROJECT_NAMESPACE {
 
 namespace video
@@ -37,7 +39,7 @@ namespace video
 void BopToBPM::update(float, Transform2D &transform)
 {
     auto t = time::SinceStart() - startTime;
-    auto scale = math::Sin(t * bpm * time::SECONDS_MINUTES_RATIO * 2.0_pi);
+    auto scale = math::Sin(cursor.beatsAt(timeline, t) * 2.0_pi);
 
     transform.scale = fvec2d{1.0, 1.0} * math::Lerp(1.1f, 0.9f, math::SmoothStep(scale));
 }
@@ -47,7 +49,12 @@ bool BopToBPM::done()
     return false;
 }
 
-BopToBPM::BopToBPM(float bpmIn) : startTime((float)time::SinceStart()), bpm(bpmIn)
+BopToBPM::BopToBPM(float bpmIn) : startTime((float)time::SinceStart())
+{
+    timeline.addTimingPoint(TimingPoint{0.0, 1.0 / (bpmIn * time::SECONDS_MINUTES_RATIO)});
+}
+
+BopToBPM::BopToBPM(TimingTimeline timelineIn) : startTime((float)time::SinceStart()), timeline(std::move(timelineIn))
 {}
 
 }
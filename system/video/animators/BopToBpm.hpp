@@ -26,22 +26,33 @@
 #include "define.hpp"
 
 #include "IAnimation.hpp"
+#include "TimingTimeline.hpp"
 
 namespace PROJECT_NAMESPACE {
 
 namespace video
 {
 
+/**
+ * Pulses the scale once every beat, either at a fixed tempo or following the timing points of a song.
+ */
 class BopToBPM : public detail::IAnimation
 {
 public:
     BopToBPM(float bpm);
 
+    /**
+     * @param timeline Tempo changes to follow, time 0 of the timeline is when the animation is created.
+     */
+    explicit BopToBPM(TimingTimeline timeline);
+
     void update(float delta, Transform2D &transform) override;
     bool done() override;
 
 protected:
-    float startTime, bpm;
+    float startTime;
+    TimingTimeline timeline;
+    TimingTimeline::Cursor cursor;
 };
 
 }